@@ -5,6 +5,6 @@ CONFIG += qt warn_on
 include(config.pri)
 include($$quote($$_PRO_FILE_PWD_)/../qdropbox/static.pri)
 
-LIBS += -lbb -lbbsystem -lbbplatform -lbbnetwork -lbbdata
+LIBS += -lbb -lbbsystem -lbbplatform -lbbnetwork -lbbdata -lbbdevice
 
 QT += network core sql
\ No newline at end of file
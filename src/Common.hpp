@@ -27,7 +27,16 @@
 #define AUTOLOAD_SETTINGS "autoload.camera.files"
 #define AUTOLOAD_CAMERA_FILES_ENABLED "autoload.camera.files.enabled"
 #define AUTOLOAD_CAMERA_FILES_DISABLED "autoload.camera.files.disabled"
+#define AUTOLOAD_PROPAGATE_DELETIONS "autoload.camera.files.propagate_deletions"
+#define AUTOLOAD_QUIET_PERIOD "autoload.camera.files.quiet_period"
 #define SYNC_COMMAND "sync"
 #define CACHE_DIR "/data/cache"
+#define UPLOADS_RATE_WIFI "uploads.rate.wifi"
+#define UPLOADS_RATE_CELLULAR "uploads.rate.cellular"
+#define UPLOADS_FULL_SPEED_CHARGING "uploads.full_speed.charging"
+#define UPLOADS_FULL_SPEED_FROM "uploads.full_speed.from"
+#define UPLOADS_FULL_SPEED_TO "uploads.full_speed.to"
+#define DB_PROFILING "db.profiling.enabled"
+#define DB_PROFILING_SLOW_MS "db.profiling.slow_ms"
 
 #endif /* COMMON_HPP_ */
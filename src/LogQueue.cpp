@@ -0,0 +1,199 @@
+/*
+ * LogQueue.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#include "LogQueue.hpp"
+#include "Logger.hpp"
+#include "vendor/Console.hpp"
+#include <QDateTime>
+#include <QSettings>
+#include <stdio.h>
+
+#define RING_SIZE 4096 // power of two
+#define RING_MASK (RING_SIZE - 1)
+#define DRAIN_INTERVAL 20 // ms
+#define SETTINGS_INTERVAL 5000 // ms
+#define CONSOLE_SETTING "sendToConsoleDebug"
+#define SYNC_TIMEOUT 500 // ms
+
+QAtomicPointer<LogQueue> LogQueue::s_instance(0);
+
+// plain reads of QAtomicInt carry no barrier in Qt 4
+static inline int loadAcquire(QAtomicInt& value) {
+    return value.fetchAndAddAcquire(0);
+}
+
+LogQueue::LogQueue() : QThread(), m_ring(new Record[RING_SIZE]), m_enqueuePos(0), m_dequeuePos(0), m_dropped(0), m_running(true),
+        m_pConsole(0), m_consoleEnabled(true), m_settingsReadAt(0), m_lastSecond(0) {
+    for (int i = 0; i < RING_SIZE; i++) {
+        m_ring[i].sequence = i;
+    }
+}
+
+LogQueue::~LogQueue() {
+    delete[] m_ring;
+}
+
+LogQueue* LogQueue::instance() {
+    return s_instance.fetchAndAddAcquire(0);
+}
+
+void LogQueue::start() {
+    if (instance() == 0) {
+        LogQueue* queue = new LogQueue();
+        queue->QThread::start(QThread::LowestPriority);
+        s_instance.fetchAndStoreRelease(queue);
+    }
+}
+
+void LogQueue::stop() {
+    LogQueue* queue = s_instance.fetchAndStoreOrdered(0);
+    if (queue != 0) {
+        // new records go to stdout from here on, the drain picks up whatever got in before
+        queue->m_running = false;
+        queue->wait();
+        // not deleted, a producer on another thread may still be inside enqueue()
+    }
+}
+
+void LogQueue::push(const int& level, const QString& clazz, const QString& message) {
+    LogQueue* queue = instance();
+    if (queue == 0) {
+        // not started yet or already stopped, nothing to hand over to
+        fprintf(stdout, "%s\n", (clazz.isEmpty() ? message : clazz + " - " + message).toLocal8Bit().constData());
+        fflush(stdout);
+        return;
+    }
+    queue->enqueue(level, clazz, message);
+}
+
+void LogQueue::pushSync(const int& level, const QString& clazz, const QString& message) {
+    Q_UNUSED(level);
+    LogQueue* queue = instance();
+    if (queue != 0 && QThread::currentThread() != queue) {
+        // whatever was logged before goes out first, so the record lands after its context
+        queue->waitDrained(SYNC_TIMEOUT);
+    }
+    fprintf(stdout, "%s\n", (clazz.isEmpty() ? message : clazz + " - " + message).toLocal8Bit().constData());
+    fflush(stdout);
+}
+
+bool LogQueue::waitDrained(const int& timeout) {
+    // the consumer goes in ticket order, so the ring is drained once the last ticket's slot was released
+    for (int waited = 0; waited < timeout; waited++) {
+        int pos = loadAcquire(m_enqueuePos);
+        if (pos == 0 || loadAcquire(m_ring[(pos - 1) & RING_MASK].sequence) == pos - 1 + RING_SIZE) {
+            return true;
+        }
+        if (!isRunning()) {
+            return false;
+        }
+        msleep(1);
+    }
+    return false;
+}
+
+int LogQueue::dropped() {
+    LogQueue* queue = instance();
+    return queue != 0 ? (int) queue->m_dropped : 0;
+}
+
+bool LogQueue::enqueue(const int& level, const QString& clazz, const QString& message) {
+    // Vyukov's bounded queue: a slot is free for ticket pos when its sequence equals pos
+    // and readable by the consumer when it equals pos + 1
+    Record* record = 0;
+    int pos = m_enqueuePos;
+    forever {
+        record = &m_ring[pos & RING_MASK];
+        int diff = loadAcquire(record->sequence) - pos;
+        if (diff == 0) {
+            if (m_enqueuePos.testAndSetRelaxed(pos, pos + 1)) {
+                break;
+            }
+        } else if (diff < 0) {
+            m_dropped.fetchAndAddRelaxed(1);
+            return false;
+        }
+        pos = m_enqueuePos;
+    }
+
+    record->time = QDateTime::currentMSecsSinceEpoch();
+    record->level = level;
+    record->clazz = clazz;
+    record->message = message;
+    record->sequence.fetchAndStoreRelease(pos + 1);
+    return true;
+}
+
+void LogQueue::run() {
+    m_pConsole = new Console();
+    while (m_running) {
+        if (drain() == 0) {
+            msleep(DRAIN_INTERVAL);
+        }
+    }
+    drain();
+    if (m_pConsole->getDropped()) {
+        fprintf(stdout, "Console records sent: %d, dropped: %d\n", m_pConsole->getSent(), m_pConsole->getDropped());
+    }
+    delete m_pConsole;
+    m_pConsole = 0;
+}
+
+int LogQueue::drain() {
+    int count = 0;
+    forever {
+        Record& record = m_ring[m_dequeuePos & RING_MASK];
+        if (loadAcquire(record.sequence) - (m_dequeuePos + 1) != 0) {
+            break;
+        }
+
+        write(record);
+        record.clazz.clear();
+        record.message.clear();
+        record.sequence.fetchAndStoreRelease(m_dequeuePos + RING_SIZE);
+        m_dequeuePos++;
+        count++;
+    }
+
+    if (count) {
+        fflush(stdout);
+        m_pConsole->flush();
+    }
+    return count;
+}
+
+void LogQueue::write(const Record& record) {
+    QString line = format(record);
+    fprintf(stdout, "%s\n", line.toLocal8Bit().constData());
+
+    readSettings(record.time);
+    if (m_consoleEnabled) {
+        m_pConsole->append("ConsoleThis", line);
+    }
+}
+
+QString LogQueue::format(const Record& record) {
+    if (record.clazz.isEmpty()) {
+        return record.message;
+    }
+
+    // the date only changes once a second, so it is formatted once a second
+    uint second = (uint) (record.time / 1000);
+    if (second != m_lastSecond) {
+        m_lastSecond = second;
+        m_lastDate = QDateTime::fromMSecsSinceEpoch(record.time).toString(Qt::SystemLocaleShortDate);
+    }
+    return "[" + Logger::levelName(record.level) + "] [" + m_lastDate + "] - " + record.clazz + " - " + record.message;
+}
+
+void LogQueue::readSettings(const qint64& now) {
+    if (now - m_settingsReadAt >= SETTINGS_INTERVAL) {
+        m_settingsReadAt = now;
+        QSettings settings;
+        m_consoleEnabled = settings.value(CONSOLE_SETTING, true).toBool();
+    }
+}
@@ -0,0 +1,76 @@
+/*
+ * LogQueue.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#ifndef LOGQUEUE_HPP_
+#define LOGQUEUE_HPP_
+
+#include <QThread>
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QString>
+
+class Console;
+
+/**
+ * Bounded lock-free queue of log records drained by a background thread.
+ * Producers never block: when the ring is full the record is dropped and counted.
+ * Timestamps are taken by the producer but formatted by the drain thread, which also
+ * owns the only Console socket.
+ * pushSync() is for records the process may not survive (qFatal, failed asserts): it
+ * waits for the ring to drain and writes the record itself before returning.
+ * stop() drains and ends the thread but never frees the queue: a producer may still
+ * hold the instance it loaded, so the ring stays allocated until the process exits.
+ */
+class LogQueue: public QThread {
+    Q_OBJECT
+public:
+    static void start();
+    static void stop();
+    static void push(const int& level, const QString& clazz, const QString& message);
+    static void pushSync(const int& level, const QString& clazz, const QString& message);
+    static int dropped();
+
+protected:
+    void run();
+
+private:
+    struct Record {
+        QAtomicInt sequence;
+        qint64 time;
+        int level;
+        QString clazz;
+        QString message;
+    };
+
+    static QAtomicPointer<LogQueue> s_instance;
+
+    Record* m_ring;
+    QAtomicInt m_enqueuePos;
+    int m_dequeuePos;
+    QAtomicInt m_dropped;
+    volatile bool m_running;
+
+    Console* m_pConsole;
+    bool m_consoleEnabled;
+    qint64 m_settingsReadAt;
+    uint m_lastSecond;
+    QString m_lastDate;
+
+    static LogQueue* instance();
+
+    LogQueue();
+    virtual ~LogQueue();
+
+    bool enqueue(const int& level, const QString& clazz, const QString& message);
+    bool waitDrained(const int& timeout);
+    int drain();
+    void write(const Record& record);
+    QString format(const Record& record);
+    void readSettings(const qint64& now);
+};
+
+#endif /* LOGQUEUE_HPP_ */
@@ -6,8 +6,7 @@
  */
 
 #include "Logger.hpp"
-#include <QDebug>
-#include <QDateTime>
+#include "LogQueue.hpp"
 
 Logger::Logger(const QString& clazz, QObject* parent) : QObject(parent), m_class(clazz) {}
 
@@ -22,11 +21,19 @@ Logger Logger::getLogger(const QString& clazz) {
     return logger;
 }
 
+QString Logger::levelName(const int& level) {
+    switch (level) {
+        case LOG_LEVEL_DEBUG: return "DEBUG";
+        case LOG_LEVEL_INFO: return "INFO";
+        case LOG_LEVEL_WARN: return "WARN";
+        default: return "ERROR";
+    }
+}
+
 const QString& Logger::getClass() const {
     return m_class;
 }
 
-QString Logger::currDateString() {
-    return QDateTime::currentDateTime().toString(Qt::SystemLocaleShortDate);
+void Logger::write(const int& level, const QString& message) {
+    LogQueue::push(level, m_class, message);
 }
-
@@ -13,6 +13,23 @@
 #include <QNetworkReply>
 #include <QDebug>
 
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+
+// calls below LOG_LEVEL compile to nothing, but their arguments are still built at the
+// call site. Where building the message costs, use LOG_DEBUG, which skips the expression too
+#ifndef LOG_LEVEL
+#ifdef QT_NO_DEBUG
+#define LOG_LEVEL LOG_LEVEL_INFO
+#else
+#define LOG_LEVEL LOG_LEVEL_DEBUG
+#endif
+#endif
+
+#define LOG_DEBUG(logger, message) do { if (LOG_LEVEL <= LOG_LEVEL_DEBUG) { (logger).debug(message); } } while (0)
+
 class Logger: public QObject {
     Q_OBJECT
 public:
@@ -21,32 +38,56 @@ public:
     virtual ~Logger();
 
     static Logger getLogger(const QString& clazz);
+    static QString levelName(const int& level);
 
     const QString& getClass() const;
 
     template <typename T> void info(const T& t) {
-        log("INFO", t);
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+        log(LOG_LEVEL_INFO, t);
+#else
+        Q_UNUSED(t);
+#endif
     }
 
     template <typename T> void error(const T& t) {
-        log("ERROR", t);
+#if LOG_LEVEL <= LOG_LEVEL_ERROR
+        log(LOG_LEVEL_ERROR, t);
+#else
+        Q_UNUSED(t);
+#endif
     }
 
     template <typename T> void debug(const T& t) {
-        log("DEBUG", t);
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+        log(LOG_LEVEL_DEBUG, t);
+#else
+        Q_UNUSED(t);
+#endif
     }
 
     template <typename T> void warn(const T& t) {
-        log("WARN", t);
+#if LOG_LEVEL <= LOG_LEVEL_WARN
+        log(LOG_LEVEL_WARN, t);
+#else
+        Q_UNUSED(t);
+#endif
     }
 
 private:
     QString m_class;
 
-    QString currDateString();
+    void write(const int& level, const QString& message);
+
+    void log(const int& level, const QString& message) {
+        write(level, message);
+    }
 
-    template <typename T> void log(const QString& level, const T& t) {
-        qDebug() << "[" << level << "]" << "[" << currDateString() << "] -" << m_class << "-" << t << endl;
+    // anything other than a string is only formatted once its level is known to be on
+    template <typename T> void log(const int& level, const T& t) {
+        QString message;
+        QDebug(&message) << t;
+        write(level, message);
     }
 };
 
@@ -6,40 +6,106 @@
  */
 
 #include "Watcher.hpp"
+#include <QDateTime>
+#include <QtConcurrentMap>
+#include <QtConcurrentRun>
+
+#if (defined(Q_OS_LINUX) || defined(Q_OS_QNX)) && !defined(QT_NO_INOTIFY)
+#define WATCHER_INOTIFY
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
 
 #define INDEX_FILE_PLACE "/shared/misc/"
 #define INTERVAL 60000
+#define DEBOUNCE_INTERVAL 1500
+#define DEBOUNCE_MAX_DELAY 5000 // continuous writes can not hold events back for longer than this
 
 Logger Watcher::logger = Logger::getLogger("Watcher");
 
-Watcher::Watcher(QObject* parent) : QObject(parent), m_pTimer(new QTimer(this)) {
+Watcher::Watcher(QObject* parent) : QObject(parent), m_pTimer(new QTimer(this)), m_pDebounce(new QTimer(this)),
+        m_inotifyFd(-1), m_pNotifier(0), m_overflow(false) {
     QObject::connect(m_pTimer, SIGNAL(timeout()), this, SLOT(onTimeout()));
+    QObject::connect(m_pDebounce, SIGNAL(timeout()), this, SLOT(onDebounceTimeout()));
+
+    m_pDebounce->setInterval(DEBOUNCE_INTERVAL);
+    m_pDebounce->setSingleShot(true);
+
+#ifdef WATCHER_INOTIFY
+    m_inotifyFd = inotify_init();
+    if (m_inotifyFd != -1) {
+        fcntl(m_inotifyFd, F_SETFD, FD_CLOEXEC);
+        fcntl(m_inotifyFd, F_SETFL, fcntl(m_inotifyFd, F_GETFL) | O_NONBLOCK);
+        m_pNotifier = new QSocketNotifier(m_inotifyFd, QSocketNotifier::Read, this);
+        QObject::connect(m_pNotifier, SIGNAL(activated(int)), this, SLOT(onInotifyActivated(int)));
+    } else {
+        logger.warn("inotify is not available, falling back to polling");
+    }
+#endif
 
-    m_pTimer->setInterval(INTERVAL);
-    m_pTimer->setSingleShot(false);
-    m_pTimer->start();
+    if (m_inotifyFd == -1) {
+        m_pTimer->setInterval(INTERVAL);
+        m_pTimer->setSingleShot(false);
+        m_pTimer->start();
+    }
 }
 
 Watcher::~Watcher() {
     logger.debug("Destroy");
     m_pTimer->deleteLater();
+    m_pDebounce->deleteLater();
+#ifdef WATCHER_INOTIFY
+    if (m_inotifyFd != -1) {
+        m_pNotifier->setEnabled(false);
+        m_pNotifier->deleteLater();
+        ::close(m_inotifyFd);
+    }
+#endif
 }
 
 void Watcher::addPath(const QString& path) {
+    watch(path, 0);
+}
+
+void Watcher::addPath(const QString& path, const QStringList& files) {
+    watch(path, &files);
+}
+
+void Watcher::watch(const QString& path, const QStringList* files) {
     if (!m_paths.contains(path)) {
         logger.info("Adding path for watching: " + path);
 
         QString name = path.split("/").last();
         m_paths[path] = name;
 
-        updateIndex(name, entryList(path));
+        QFile stored(snapshotPath(name));
+        if (stored.exists()) {
+            // catch up with files added while we were not watching, a bare file list cannot tell what changed.
+            // Files deleted meanwhile are dropped silently, the index takes that time as its baseline
+            loadRoot(path);
+            syncRoot(path, NotifyAdded);
+        } else if (files != 0) {
+            seedRoot(path, *files);
+        } else {
+            syncRoot(path, NotifyNone);
+        }
     } else {
         logger.info("Path already in watching: " + path);
     }
 }
 
 void Watcher::unwatch(const QString& path) {
+    foreach(QString dir, m_dirs.keys()) {
+        if (m_dirs.value(dir).root.compare(path) == 0) {
+            removeWatch(dir);
+            m_dirs.remove(dir);
+            m_pending.remove(dir);
+        }
+    }
     m_paths.remove(path);
+    m_dirtyRoots.remove(path);
+    m_resync.remove(path);
 }
 
 void Watcher::onTimeout() {
@@ -50,75 +116,387 @@ QStringList Watcher::entryList(const QString& path) {
     return QDir(path).entryList(QDir::Files | QDir::NoDotAndDotDot, QDir::Time);
 }
 
-QStringList Watcher::checkForAddedEntries(const QStringList& newEntries, const QStringList& oldEntries) {
-    QStringList addedEntries;
-    foreach(QString e, newEntries) {
-        if (!oldEntries.contains(e)) {
-            addedEntries.append(e);
+QString Watcher::snapshotPath(const QString& name) const {
+    return QDir::currentPath() + INDEX_FILE_PLACE + name + ".snap";
+}
+
+QString Watcher::relativePath(const QString& root, const QString& dir, const QString& name) const {
+    if (dir.compare(root) == 0) {
+        return name;
+    }
+    return dir.mid(root.length() + 1) + "/" + name;
+}
+
+void Watcher::sync() {
+    foreach(QString path, m_paths.keys()) {
+        syncRoot(path);
+    }
+}
+
+void Watcher::loadRoot(const QString& root) {
+    DirSnapshot stored;
+    if (!stored.load(snapshotPath(m_paths.value(root)))) {
+        return;
+    }
+
+    QHash<QString, SnapshotEntry>::const_iterator it = stored.entries().constBegin();
+    for (; it != stored.entries().constEnd(); ++it) {
+        int slash = it.key().lastIndexOf('/');
+        QString dir = slash == -1 ? root : root + "/" + it.key().left(slash);
+        DirState& state = m_dirs[dir];
+        state.root = root;
+        state.snapshot.insert(it.key().mid(slash + 1), it.value());
+    }
+}
+
+void Watcher::saveRoot(const QString& root) {
+    DirSnapshot merged;
+    foreach(QString dir, m_dirs.keys()) {
+        const DirState& state = m_dirs[dir];
+        if (state.root.compare(root) != 0) {
+            continue;
+        }
+
+        QHash<QString, SnapshotEntry>::const_iterator it = state.snapshot.entries().constBegin();
+        for (; it != state.snapshot.entries().constEnd(); ++it) {
+            merged.insert(relativePath(root, dir, it.key()), it.value());
         }
     }
-    return addedEntries;
+    merged.save(snapshotPath(m_paths.value(root)));
 }
 
-QStringList Watcher::checkForRemovedEntries(const QStringList& newEntries, const QStringList& oldEntries) {
-    QStringList removedEntries;
-    foreach(QString e, oldEntries) {
-        if (!newEntries.contains(e)) {
-            removedEntries.append(e);
+void Watcher::syncRoot(const QString& root, int notify) {
+    if (m_syncing.contains(root)) {
+        // runs again once the current sync is applied
+        m_resync[root] = m_resync.value(root, NotifyNone) | notify;
+        return;
+    }
+
+    QMap<QString, DirState> known;
+    QMap<QString, DirState>::const_iterator it = m_dirs.constBegin();
+    for (; it != m_dirs.constEnd(); ++it) {
+        if (it.value().root.compare(root) == 0) {
+            known.insert(it.key(), it.value());
         }
     }
-    return removedEntries;
+    startSync(root, notify, QtConcurrent::run(&Watcher::collect, root, known));
+}
+
+void Watcher::seedRoot(const QString& root, const QStringList& files) {
+    startSync(root, NotifyNone, QtConcurrent::run(&Watcher::seed, root, files));
 }
 
-void Watcher::updateIndex(const QString& name, const QStringList& entries) {
-    QFile file(QDir::currentPath() + INDEX_FILE_PLACE + name + ".txt");
-    if (file.exists()) {
-        file.remove();
+void Watcher::startSync(const QString& root, int notify, const QFuture<SyncResult>& future) {
+    m_syncing[root] = notify;
+
+    QFutureWatcher<SyncResult>* watcher = new QFutureWatcher<SyncResult>(this);
+    bool res = QObject::connect(watcher, SIGNAL(finished()), this, SLOT(onSyncFinished()));
+    Q_ASSERT(res);
+    Q_UNUSED(res);
+    watcher->setFuture(future);
+}
+
+Watcher::SyncResult Watcher::collect(const QString& root, const QMap<QString, DirState>& known) {
+    SyncResult result;
+    result.root = root;
+    result.dirs = DirSnapshot::subdirs(root, &result.complete);
+    result.scannedAt = QDateTime::currentDateTime().toTime_t();
+
+    foreach(QString dir, result.dirs) {
+        qint64 mtime = DirSnapshot::mtime(dir);
+        QMap<QString, DirState>::const_iterator it = known.constFind(dir);
+        // mtime has one second resolution, so a directory scanned in the same second it changed is rescanned
+        if (it == known.constEnd() || it.value().mtime != mtime || it.value().mtime >= it.value().scannedAt - 1) {
+            result.stale.append(dir);
+            result.mtimes.append(mtime);
+        }
+    }
+
+    // already on a pool thread, which takes part in the map instead of just waiting for it
+    result.scans = QtConcurrent::blockingMapped<QList<DirSnapshot> >(result.stale, &DirSnapshot::scan);
+    return result;
+}
+
+Watcher::SyncResult Watcher::seed(const QString& root, const QStringList& files) {
+    SyncResult result;
+    result.root = root;
+    result.dirs = DirSnapshot::subdirs(root, &result.complete);
+    result.scannedAt = QDateTime::currentDateTime().toTime_t();
+
+    QHash<QString, DirSnapshot> byDir;
+    foreach(QString filePath, files) {
+        int slash = filePath.lastIndexOf('/');
+        SnapshotEntry entry;
+        if (slash != -1 && DirSnapshot::stat(filePath, entry)) {
+            byDir[filePath.left(slash)].insert(filePath.mid(slash + 1), entry);
+        }
+    }
+
+    foreach(QString dir, result.dirs) {
+        result.stale.append(dir);
+        result.mtimes.append(DirSnapshot::mtime(dir));
+        result.scans.append(byDir.value(dir));
     }
-    file.open(QIODevice::ReadWrite | QIODevice::Text);
+    return result;
+}
 
+void Watcher::onSyncFinished() {
+    QFutureWatcher<SyncResult>* watcher = static_cast<QFutureWatcher<SyncResult>*>(QObject::sender());
+    SyncResult result = watcher->result();
+    watcher->deleteLater();
 
-    QTextStream out(&file);
-    foreach(QString f, entries) {
-        out << f << endl;
+    QString root = result.root;
+    int notify = m_syncing.take(root);
+    if (m_paths.contains(root)) {
+        applySync(result, notify);
     }
 
+    if (m_resync.contains(root)) {
+        syncRoot(root, m_resync.take(root));
+    }
 
-    file.close();
-    logger.info("Index file updated: " + name + ", entries count: " + QString::number(entries.size()) + ", file size: " + QString::number(file.size()));
+    // events held back while the sync was running
+    if (!m_pending.isEmpty()) {
+        m_pDebounce->start(DEBOUNCE_INTERVAL);
+    }
 }
 
-void Watcher::sync() {
-    foreach(QString path, m_paths.keys()) {
-        QStringList newEntries = entryList(path);
-
-        QString name = m_paths.value(path);
-        QFile file(QDir::currentPath() + INDEX_FILE_PLACE + name + ".txt");
-        file.open(QIODevice::ReadWrite | QIODevice::Text);
-
-        QStringList addedEntries;
-        QTextStream in(&file);
-
-        foreach(QString newE, newEntries) {
-            in.seek(0);
-            bool found = false;
-            while (!in.atEnd()) {
-                QString line = in.readLine();
-                if (line.contains(newE)) {
-                    found = true;
-                    break;
-                }
+void Watcher::applySync(const SyncResult& result, int notify) {
+    const QString& root = result.root;
+    QSet<QString> present = result.dirs.toSet();
+
+    QStringList added;
+    QStringList removed;
+    int modified = 0;
+    int unreadable = 0;
+
+    foreach(QString dir, m_dirs.keys()) {
+        const DirState& state = m_dirs[dir];
+        // with part of the tree unreadable a missing directory may still exist, keep it until the next sync
+        if (result.complete && state.root.compare(root) == 0 && !present.contains(dir)) {
+            foreach(QString name, state.snapshot.names()) {
+                removed.append(relativePath(root, dir, name));
+            }
+            removeWatch(dir);
+            m_dirs.remove(dir);
+        }
+    }
+
+    for (int i = 0; i < result.stale.size(); i++) {
+        QString dir = result.stale.at(i);
+        if (!result.scans.at(i).isValid()) {
+            // an unreadable directory keeps its old snapshot, reporting it as emptied would remove its files
+            logger.warn("Cannot read " + dir + ", keeping its snapshot");
+            unreadable++;
+            continue;
+        }
+
+        if (!m_dirs.contains(dir)) {
+            addWatch(dir);
+        }
+
+        DirState& state = m_dirs[dir];
+        state.root = root;
+        SnapshotDiff diff = DirSnapshot::diff(state.snapshot, result.scans.at(i));
+        foreach(QString name, diff.added) {
+            added.append(relativePath(root, dir, name));
+        }
+        foreach(QString name, diff.removed) {
+            removed.append(relativePath(root, dir, name));
+        }
+        modified += diff.modified.size();
+
+        state.snapshot = result.scans.at(i);
+        state.mtime = result.mtimes.at(i);
+        state.scannedAt = result.scannedAt;
+    }
+
+    if (added.isEmpty() && removed.isEmpty() && modified == 0 && QFile::exists(snapshotPath(m_paths.value(root)))) {
+        return;
+    }
+
+    saveRoot(root);
+    logger.info("Snapshot updated: " + m_paths.value(root) + ", dirs: " + QString::number(result.dirs.size()) + ", rescanned: " + QString::number(result.stale.size() - unreadable) +
+            ", added: " + QString::number(added.size()) + ", removed: " + QString::number(removed.size()) + ", modified: " + QString::number(modified));
+
+    if ((notify & NotifyAdded) && added.size()) {
+        emit filesAdded(root, added);
+    }
+    if ((notify & NotifyRemoved) && removed.size()) {
+        emit filesRemoved(root, removed);
+    }
+}
+
+void Watcher::onInotifyActivated(int fd) {
+#ifdef WATCHER_INOTIFY
+    char buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    ssize_t len;
+    while ((len = ::read(fd, buffer, sizeof(buffer))) > 0) {
+        for (char* p = buffer; p < buffer + len;) {
+            struct inotify_event* event = reinterpret_cast<struct inotify_event*>(p);
+            p += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                m_overflow = true;
+                continue;
             }
 
-            if (!found) {
-                addedEntries.append(newE);
+            QString path = m_watches.value(event->wd);
+            if (path.isEmpty() || event->len == 0) {
+                continue;
+            }
+
+            if (event->mask & IN_ISDIR) {
+                m_dirtyRoots.insert(m_dirs.value(path).root);
+                continue;
+            }
+
+            // files show up on IN_CLOSE_WRITE or IN_MOVED_TO, IN_CREATE is only watched for subdirectories
+            if (event->mask & IN_CREATE) {
+                continue;
+            }
+
+            QString name = QFile::decodeName(event->name);
+            if (name.startsWith(".")) {
+                continue;
+            }
+
+            Pending& pending = m_pending[path];
+            if (pending.firstEventAt == 0) {
+                pending.firstEventAt = now;
+            }
+            if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                pending.changed.remove(name);
+                pending.removed.insert(name);
+            } else {
+                pending.removed.remove(name);
+                pending.changed.insert(name);
             }
         }
-        file.close();
+    }
 
-        updateIndex(name, newEntries);
-        if (addedEntries.size()) {
-            emit filesAdded(path, addedEntries);
+    // quiet period restarts on every event, but never past DEBOUNCE_MAX_DELAY from the oldest pending one
+    qint64 oldest = now;
+    foreach(const Pending& pending, m_pending) {
+        if (pending.firstEventAt != 0 && pending.firstEventAt < oldest) {
+            oldest = pending.firstEventAt;
         }
     }
+    m_pDebounce->start((int) qBound((qint64) 0, oldest + DEBOUNCE_MAX_DELAY - now, (qint64) DEBOUNCE_INTERVAL));
+#else
+    Q_UNUSED(fd);
+#endif
+}
+
+void Watcher::onDebounceTimeout() {
+    if (m_overflow) {
+        logger.warn("inotify queue overflow, rescanning");
+        m_overflow = false;
+        m_pending.clear();
+        sync();
+        return;
+    }
+
+    QSet<QString> dirtyRoots = m_dirtyRoots;
+    m_dirtyRoots.clear();
+    foreach(QString root, dirtyRoots) {
+        if (m_paths.contains(root)) {
+            syncRoot(root);
+        }
+    }
+
+    QMap<QString, Pending> pending = m_pending;
+    m_pending.clear();
+    foreach(QString dir, pending.keys()) {
+        if (!m_dirs.contains(dir) || dirtyRoots.contains(m_dirs.value(dir).root)) {
+            continue;
+        }
+
+        if (m_syncing.contains(m_dirs.value(dir).root)) {
+            // the running sync may have read the directory before these events, apply them after it
+            m_pending[dir] = pending.value(dir);
+        } else {
+            applyPending(dir, pending.value(dir));
+        }
+    }
+}
+
+void Watcher::applyPending(const QString& dir, const Pending& pending) {
+    DirState& state = m_dirs[dir];
+    DirSnapshot& snapshot = state.snapshot;
+    QStringList added;
+    QStringList removed;
+    bool changed = false;
+
+    foreach(QString name, pending.changed) {
+        SnapshotEntry entry;
+        if (!DirSnapshot::stat(dir + "/" + name, entry)) {
+            continue;
+        }
+
+        if (!snapshot.entries().contains(name)) {
+            added.append(relativePath(state.root, dir, name));
+            changed = true;
+        } else if (snapshot.entries().value(name) != entry) {
+            changed = true;
+        }
+        snapshot.insert(name, entry);
+    }
+
+    foreach(QString name, pending.removed) {
+        if (snapshot.entries().contains(name)) {
+            snapshot.remove(name);
+            removed.append(relativePath(state.root, dir, name));
+            changed = true;
+        }
+    }
+
+    if (!changed) {
+        return;
+    }
+
+    QString root = state.root;
+    saveRoot(root);
+    logger.info("Snapshot updated: " + dir + ", added: " + QString::number(added.size()) + ", removed: " + QString::number(removed.size()) +
+            ", event to emit: " + QString::number(QDateTime::currentMSecsSinceEpoch() - pending.firstEventAt) + " ms");
+
+    if (added.size()) {
+        emit filesAdded(root, added);
+    }
+    if (removed.size()) {
+        emit filesRemoved(root, removed);
+    }
+}
+
+void Watcher::addWatch(const QString& path) {
+#ifdef WATCHER_INOTIFY
+    if (m_inotifyFd == -1) {
+        return;
+    }
+
+    int wd = inotify_add_watch(m_inotifyFd, QFile::encodeName(path).constData(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_CREATE | IN_ONLYDIR);
+    if (wd == -1) {
+        logger.error("Cannot add inotify watch for " + path + ", polling instead");
+        m_pTimer->setInterval(INTERVAL);
+        m_pTimer->start();
+        return;
+    }
+    m_watches[wd] = path;
+#else
+    Q_UNUSED(path);
+#endif
+}
+
+void Watcher::removeWatch(const QString& path) {
+#ifdef WATCHER_INOTIFY
+    int wd = m_watches.key(path, -1);
+    if (wd != -1) {
+        inotify_rm_watch(m_inotifyFd, wd);
+        m_watches.remove(wd);
+    }
+#else
+    Q_UNUSED(path);
+#endif
 }
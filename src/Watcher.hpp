@@ -11,13 +11,28 @@
 #include <QObject>
 #include <QStringList>
 #include <QMap>
+#include <QHash>
+#include <QSet>
 #include <QDir>
 #include <QFile>
 #include <QTextStream>
 #include <QDirIterator>
+#include <QSocketNotifier>
+#include <QFutureWatcher>
 #include "Logger.hpp"
+#include "util/DirSnapshot.hpp"
 #include <QTimer>
 
+/**
+ * Watches directory trees for new files. Backed by inotify where available: events are
+ * collected for a short debounce window and applied to the snapshot of the directory
+ * they came from. Every directory keeps its own snapshot and mtime, so a rescan (queue
+ * overflow, new subdirectory, polling fallback) only re-reads directories that changed.
+ * Syncs run off the event loop, directories are read in parallel on the thread pool and
+ * the result is applied back on the watcher's thread. A root added with a file list
+ * already taken by the caller is seeded from that list instead of being read again.
+ * Entries are reported relative to the watched root.
+ */
 class Watcher: public QObject {
     Q_OBJECT
 public:
@@ -25,6 +40,7 @@ public:
     virtual ~Watcher();
 
     void addPath(const QString& path);
+    void addPath(const QString& path, const QStringList& files);
     void unwatch(const QString& path);
     QStringList entryList(const QString& path);
     void sync();
@@ -35,16 +51,77 @@ public:
 
 private slots:
     void onTimeout();
+    void onInotifyActivated(int fd);
+    void onDebounceTimeout();
+    void onSyncFinished();
 
 private:
+    struct DirState {
+        QString root;
+        DirSnapshot snapshot;
+        qint64 mtime;
+        qint64 scannedAt;
+
+        DirState() : mtime(-1), scannedAt(0) {}
+    };
+
+    struct Pending {
+        QSet<QString> changed;
+        QSet<QString> removed;
+        qint64 firstEventAt;
+
+        Pending() : firstEventAt(0) {}
+    };
+
+    enum Notify {
+        NotifyNone = 0,
+        NotifyAdded = 1,
+        NotifyRemoved = 2,
+        NotifyAll = NotifyAdded | NotifyRemoved
+    };
+
+    struct SyncResult {
+        QString root;
+        QStringList dirs;
+        bool complete;
+        QStringList stale;
+        QList<qint64> mtimes;
+        QList<DirSnapshot> scans;
+        qint64 scannedAt;
+
+        SyncResult() : complete(false), scannedAt(0) {}
+    };
+
     static Logger logger;
 
     QTimer* m_pTimer;
+    QTimer* m_pDebounce;
     QMap<QString, QString> m_paths;
+    QMap<QString, DirState> m_dirs;
+
+    int m_inotifyFd;
+    QSocketNotifier* m_pNotifier;
+    QHash<int, QString> m_watches;
+    QMap<QString, Pending> m_pending;
+    QSet<QString> m_dirtyRoots;
+    bool m_overflow;
+    QMap<QString, int> m_syncing;
+    QMap<QString, int> m_resync;
 
-    QStringList checkForAddedEntries(const QStringList& newEntries, const QStringList& oldEntries);
-    QStringList checkForRemovedEntries(const QStringList& newEntries, const QStringList& oldEntries);
-    void updateIndex(const QString& name, const QStringList& entries);
+    QString snapshotPath(const QString& name) const;
+    QString relativePath(const QString& root, const QString& dir, const QString& name) const;
+    void loadRoot(const QString& root);
+    void saveRoot(const QString& root);
+    void watch(const QString& path, const QStringList* files);
+    void syncRoot(const QString& root, int notify = NotifyAll);
+    void seedRoot(const QString& root, const QStringList& files);
+    void startSync(const QString& root, int notify, const QFuture<SyncResult>& future);
+    void applySync(const SyncResult& result, int notify);
+    static SyncResult collect(const QString& root, const QMap<QString, DirState>& known);
+    static SyncResult seed(const QString& root, const QStringList& files);
+    void applyPending(const QString& dir, const Pending& pending);
+    void addWatch(const QString& path);
+    void removeWatch(const QString& path);
 };
 
 #endif /* WATCHER_HPP_ */
@@ -10,11 +10,22 @@
 #include <QDirIterator>
 #include <QFile>
 #include <QSettings>
+#include <QElapsedTimer>
+#include <QDateTime>
+#include <QMultiMap>
+#include <QRegExp>
 
 #define DB_NAME "basket.db"
+#define SLOW_QUERY_LOG "/data/cache/slow_queries.log"
+#define SLOW_QUERY_LOG_MAX_SIZE 524288 // 512 KB, then rotated to .1
+#define NORMALIZED_CACHE_SIZE 512
 
 Logger DB::logger = Logger::getLogger("DB::Service");
 SqlDataAccess* DB::m_pSda = 0;
+bool DB::s_profiling = false;
+int DB::s_slowThreshold = 50;
+QMap<QString, StatementStats> DB::s_stats;
+QHash<QString, QString> DB::s_normalized;
 
 DB::DB(QObject* parent) : QObject(parent) {
     QSettings qsettings;
@@ -35,11 +46,146 @@ DB::~DB() {
 
 QVariant DB::execute(const QString& query) {
 //    logger.debug(query);
-    return m_pSda->execute(query);
+    return run(query, 0);
 }
 
 QVariant DB::execute(const QString& query, const QVariantMap& values) {
 //    logger.debug(query);
 //    logger.debug(values);
-    return m_pSda->execute(query, values);
+    return run(query, &values);
+}
+
+bool DB::hasError() {
+    if (m_pSda->hasError()) {
+        logger.error(m_pSda->error().errorMessage());
+        return true;
+    }
+    return false;
+}
+
+void DB::setProfiling(const bool& enabled, const int& slowThreshold) {
+    if (enabled != s_profiling) {
+        logger.info("SQL profiling " + QString(enabled ? "enabled" : "disabled") + ", slow threshold: " + QString::number(slowThreshold) + " ms");
+    }
+    s_profiling = enabled;
+    s_slowThreshold = slowThreshold;
+}
+
+bool DB::isProfiling() {
+    return s_profiling;
+}
+
+QVariantList DB::profile() {
+    QMultiMap<qint64, QVariantMap> byTotal;
+    foreach(QString statement, s_stats.keys()) {
+        const StatementStats& stats = s_stats[statement];
+        QVariantMap map;
+        map["statement"] = statement;
+        map["calls"] = stats.calls;
+        map["total_us"] = stats.totalUs;
+        map["p99_us"] = stats.latency->percentile(0.99);
+        map["rows"] = stats.rows;
+        byTotal.insert(stats.totalUs, map);
+    }
+
+    // most expensive first
+    QVariantList list;
+    QMapIterator<qint64, QVariantMap> it(byTotal);
+    it.toBack();
+    while (it.hasPrevious()) {
+        list.append(it.previous().value());
+    }
+    return list;
+}
+
+void DB::resetProfile() {
+    foreach(QString statement, s_stats.keys()) {
+        delete s_stats[statement].latency;
+    }
+    s_stats.clear();
+    s_normalized.clear();
+}
+
+QVariant DB::run(const QString& query, const QVariantMap* values) {
+    QElapsedTimer timer;
+    timer.start();
+    QVariant result = values != 0 ? m_pSda->execute(query, *values) : m_pSda->execute(query);
+    qint64 elapsedUs = timer.nsecsElapsed() / 1000;
+    latency()->record((int) elapsedUs);
+
+    if (s_profiling) {
+        StatementStats& stats = s_stats[normalize(query)];
+        if (stats.latency == 0) {
+            stats.latency = new Histogram();
+        }
+        stats.calls++;
+        stats.totalUs += elapsedUs;
+        stats.latency->record((int) elapsedUs);
+        if (result.type() == QVariant::List) {
+            stats.rows += result.toList().size();
+        }
+
+        if (elapsedUs >= (qint64) s_slowThreshold * 1000) {
+            logSlow(query, values, elapsedUs);
+        }
+    }
+    return result;
+}
+
+QString DB::normalize(const QString& query) {
+    if (s_normalized.contains(query)) {
+        return s_normalized.value(query);
+    }
+
+    // literals become ?, so statements built with arg() group with their bound siblings
+    static QRegExp literals("'(?:[^']|'')*'|\\b\\d+(?:\\.\\d+)?\\b");
+    static QRegExp spaces("\\s+");
+    QString normalized = QString(query).replace(literals, "?").replace(spaces, " ").trimmed();
+
+    if (s_normalized.size() < NORMALIZED_CACHE_SIZE) {
+        s_normalized[query] = normalized;
+    }
+    return normalized;
+}
+
+bool DB::explainable(const QString& query) {
+    // transactions, pragmas and DDL have no plan worth reading, and a plain INSERT only has a trivial one
+    QString statement = query.trimmed().toUpper();
+    if (statement.startsWith("SELECT") || statement.startsWith("UPDATE") || statement.startsWith("DELETE")) {
+        return true;
+    }
+    return statement.startsWith("INSERT") && statement.contains(QRegExp("\\bSELECT\\b"));
+}
+
+void DB::logSlow(const QString& query, const QVariantMap* values, const qint64& elapsedUs) {
+    QVariant plan;
+    if (explainable(query)) {
+        QString explain = "EXPLAIN QUERY PLAN " + query;
+        plan = values != 0 ? m_pSda->execute(explain, *values) : m_pSda->execute(explain);
+    }
+
+    QStringList lines;
+    lines << QDateTime::currentDateTime().toString(Qt::ISODate) + " " + QString::number(elapsedUs / 1000) + " ms: " + query;
+    foreach(QVariant v, plan.toList()) {
+        lines << "    " + v.toMap().value("detail").toString();
+    }
+    logger.warn("Slow query:\n" + lines.join("\n"));
+
+    QFile file(QDir::currentPath() + SLOW_QUERY_LOG);
+    if (file.size() > SLOW_QUERY_LOG_MAX_SIZE) {
+        QString rotated = file.fileName() + ".1";
+        QFile::remove(rotated);
+        file.rename(rotated);
+        file.setFileName(QDir::currentPath() + SLOW_QUERY_LOG);
+    }
+    if (file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        file.write((lines.join("\n") + "\n").toUtf8());
+        file.close();
+    }
+}
+
+Histogram* DB::latency() {
+    // looked up on first use, the registry may not exist yet during static initialization
+    static Histogram* histogram = Metrics::histogram("db.statement_us");
+    return histogram;
 }
@@ -14,10 +14,22 @@
 #include <QVariant>
 #include <QVariantMap>
 #include <QVariantList>
+#include <QMap>
+#include <QHash>
 #include "../Logger.hpp"
+#include "../util/Metrics.hpp"
 
 using namespace bb::data;
 
+struct StatementStats {
+    int calls;
+    qint64 totalUs;
+    qint64 rows;
+    Histogram* latency;
+
+    StatementStats() : calls(0), totalUs(0), rows(0), latency(0) {}
+};
+
 class DB: public QObject {
     Q_OBJECT
 public:
@@ -27,11 +39,28 @@ public:
     static QVariant execute(const QString& query);
     static QVariant execute(const QString& query, const QVariantMap& data);
     static QVariant execute(const QString& query, const QVariantList& data);
+    static bool hasError();
+
+    static void setProfiling(const bool& enabled, const int& slowThreshold);
+    static bool isProfiling();
+    static QVariantList profile();
+    static void resetProfile();
 
 private:
     static SqlDataAccess* m_pSda;
     static Logger logger;
 
+    static bool s_profiling;
+    static int s_slowThreshold;
+    static QMap<QString, StatementStats> s_stats;
+    static QHash<QString, QString> s_normalized;
+
+    static QVariant run(const QString& query, const QVariantMap* values);
+    static QString normalize(const QString& query);
+    static bool explainable(const QString& query);
+    static void logSlow(const QString& query, const QVariantMap* values, const qint64& elapsedUs);
+    static Histogram* latency();
+
     QSqlDatabase m_database;
 };
 
@@ -0,0 +1,244 @@
+/*
+ * FolderPrefetcher.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#include "FolderPrefetcher.hpp"
+#include <QNetworkConfiguration>
+#include <QNetworkRequest>
+#include <QUrl>
+#include "../qjson/parser.h"
+#include "../util/DownloadManager.hpp"
+#include "../util/Metrics.hpp"
+
+#define LIST_FOLDER_URL "https://api.dropboxapi.com/2/files/list_folder"
+#define LIST_FOLDER_CONTINUE_URL "https://api.dropboxapi.com/2/files/list_folder/continue"
+#define MAX_DEPTH 2
+#define MAX_FOLDERS 20
+#define IDLE_INTERVAL 3000
+
+Logger FolderPrefetcher::logger = Logger::getLogger("FolderPrefetcher");
+
+FolderPrefetcher::FolderPrefetcher(QDropboxCache* cache, QObject* parent) : QObject(parent), m_pCache(cache), m_paused(false),
+        m_pReply(0), m_budget(0), m_hits(0), m_misses(0) {
+    m_timer.setInterval(IDLE_INTERVAL);
+    m_timer.setSingleShot(true);
+
+    bool res = QObject::connect(&m_timer, SIGNAL(timeout()), this, SLOT(onTimeout()));
+    Q_ASSERT(res);
+    Q_UNUSED(res);
+}
+
+FolderPrefetcher::~FolderPrefetcher() {
+    if (m_pReply != 0) {
+        m_pReply->abort();
+        m_pReply->deleteLater();
+    }
+}
+
+void FolderPrefetcher::setAccessToken(const QString& accessToken) {
+    m_accessToken = accessToken;
+}
+
+void FolderPrefetcher::setPaused(const bool& paused) {
+    m_paused = paused;
+    if (!m_paused && !m_queue.isEmpty()) {
+        m_timer.start();
+    }
+}
+
+void FolderPrefetcher::viewed(const QString& path) {
+    QString key = path.toLower();
+    if (m_prefetched.contains(key)) {
+        m_hits++;
+        Metrics::counter("prefetch.hits")->add();
+    } else if (m_pCache->findCursor(path).isEmpty()) {
+        m_misses++;
+        Metrics::counter("prefetch.misses")->add();
+    }
+    logger.info("Prefetch hits: " + QString::number(m_hits) + ", misses: " + QString::number(m_misses));
+
+    // the most recent view wins, older walks are dropped
+    m_queue.clear();
+    m_queued.clear();
+    m_budget = MAX_FOLDERS;
+    enqueueChildren(path, 1);
+    m_timer.start();
+}
+
+void FolderPrefetcher::fetch(const QString& path) {
+    Folder f;
+    f.path = path;
+    f.depth = MAX_DEPTH;
+    f.demanded = true;
+    m_demand.enqueue(f);
+    QTimer::singleShot(0, this, SLOT(onTimeout()));
+}
+
+void FolderPrefetcher::enqueueChildren(const QString& path, const int& depth) {
+    if (depth > MAX_DEPTH) {
+        return;
+    }
+
+    foreach(QVariant v, m_pCache->findForPath(path).files) {
+        QDropboxFile file;
+        file.fromMap(v.toMap());
+        if (file.getTag().compare("folder") != 0) {
+            continue;
+        }
+
+        QString childPath = file.getPathDisplay();
+        QString key = childPath.toLower();
+        if (m_queued.contains(key)) {
+            continue;
+        }
+        m_queued.insert(key);
+
+        Folder f;
+        f.path = childPath;
+        f.depth = depth;
+        f.demanded = false;
+        m_queue.enqueue(f);
+    }
+}
+
+void FolderPrefetcher::onTimeout() {
+    if (m_pReply != 0) {
+        return;
+    }
+
+    if (!m_demand.isEmpty()) {
+        m_current = m_demand.dequeue();
+        if (m_accessToken.isEmpty() || !m_networkManager.isOnline()) {
+            emit pathListed(m_current.path);
+            done();
+            return;
+        }
+
+        m_entries.clear();
+        list(LIST_FOLDER_URL, "{\"path\": " + DownloadManager::jsonString(m_current.path) + "}");
+        return;
+    }
+
+    if (m_queue.isEmpty()) {
+        return;
+    }
+
+    if (!isIdle()) {
+        m_timer.start();
+        return;
+    }
+
+    while (!m_queue.isEmpty() && m_budget > 0) {
+        m_current = m_queue.dequeue();
+        if (!m_pCache->findCursor(m_current.path).isEmpty()) {
+            // visited or prefetched already, the poller keeps it fresh
+            enqueueChildren(m_current.path, m_current.depth + 1);
+            continue;
+        }
+
+        m_budget--;
+        m_entries.clear();
+        list(LIST_FOLDER_URL, "{\"path\": " + DownloadManager::jsonString(m_current.path) + "}");
+        return;
+    }
+}
+
+void FolderPrefetcher::list(const QString& endpoint, const QByteArray& body) {
+    QNetworkRequest req;
+    req.setUrl(QUrl(endpoint));
+    req.setRawHeader("Authorization", "Bearer " + m_accessToken.toUtf8());
+    req.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+
+    m_pReply = m_network.post(req, body);
+    bool res = QObject::connect(m_pReply, SIGNAL(finished()), this, SLOT(onFinished()));
+    Q_ASSERT(res);
+    Q_UNUSED(res);
+}
+
+void FolderPrefetcher::onFinished() {
+    QNetworkReply* reply = m_pReply;
+    m_pReply = 0;
+    reply->deleteLater();
+
+    if (reply->error() != QNetworkReply::NoError) {
+        logger.error("Prefetch failed: " + m_current.path + ", " + reply->errorString());
+        if (m_current.demanded) {
+            emit pathListed(m_current.path);
+        }
+        done();
+        return;
+    }
+
+    bool ok = false;
+    QVariantMap map = QJson::Parser().parse(reply->readAll(), &ok).toMap();
+    if (!ok) {
+        if (m_current.demanded) {
+            emit pathListed(m_current.path);
+        }
+        done();
+        return;
+    }
+
+    m_entries.append(map.value("entries").toList());
+    QString cursor = map.value("cursor").toString();
+    if (map.value("has_more").toBool()) {
+        list(LIST_FOLDER_CONTINUE_URL, "{\"cursor\": " + DownloadManager::jsonString(cursor) + "}");
+        return;
+    }
+
+    QList<QDropboxFile*> files;
+    foreach(QVariant v, m_entries) {
+        QDropboxFile* file = new QDropboxFile(this);
+        file->fromMap(v.toMap());
+        files.append(file);
+    }
+    m_pCache->updateByPath(m_current.path, files, cursor);
+    foreach(QDropboxFile* file, files) {
+        file->deleteLater();
+    }
+    m_entries.clear();
+
+    m_prefetched.insert(m_current.path.toLower());
+    logger.debug("Prefetched: " + m_current.path + ", depth: " + QString::number(m_current.depth));
+    emit pathPrefetched(m_current.path);
+    if (m_current.demanded) {
+        emit pathListed(m_current.path);
+    }
+
+    enqueueChildren(m_current.path, m_current.depth + 1);
+    done();
+}
+
+void FolderPrefetcher::done() {
+    if (!m_demand.isEmpty()) {
+        QTimer::singleShot(0, this, SLOT(onTimeout()));
+    } else {
+        m_timer.start();
+    }
+}
+
+bool FolderPrefetcher::isMetered() {
+    switch (m_networkManager.defaultConfiguration().bearerType()) {
+        case QNetworkConfiguration::BearerWLAN:
+        case QNetworkConfiguration::BearerEthernet:
+        case QNetworkConfiguration::BearerUnknown:
+            return false;
+        default:
+            return true;
+    }
+}
+
+bool FolderPrefetcher::isIdle() {
+    return !m_paused && !m_accessToken.isEmpty() && m_networkManager.isOnline() && !isMetered();
+}
+
+int FolderPrefetcher::getHits() const {
+    return m_hits;
+}
+
+int FolderPrefetcher::getMisses() const {
+    return m_misses;
+}
@@ -0,0 +1,88 @@
+/*
+ * FolderPrefetcher.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#ifndef FOLDERPREFETCHER_HPP_
+#define FOLDERPREFETCHER_HPP_
+
+#include <QObject>
+#include <QQueue>
+#include <QSet>
+#include <QTimer>
+#include <QVariantList>
+#include <QNetworkAccessManager>
+#include <QNetworkConfigurationManager>
+#include <QNetworkReply>
+#include "QDropboxCache.hpp"
+#include "../Logger.hpp"
+
+/**
+ * Lists child folders of recently viewed paths while the service is idle, so the
+ * first visit to a subfolder is served from the cache. Folders are walked breadth-first,
+ * at most MAX_DEPTH levels below the viewed path and MAX_FOLDERS per viewed path.
+ * Nothing is fetched while uploads are running or the network is cellular.
+ *
+ * fetch() lists a single folder on demand, ahead of the idle walk and regardless of
+ * uploads or bearer, and always answers with pathListed, also when listing failed.
+ */
+class FolderPrefetcher: public QObject {
+    Q_OBJECT
+public:
+    FolderPrefetcher(QDropboxCache* cache, QObject* parent = 0);
+    virtual ~FolderPrefetcher();
+
+    void setAccessToken(const QString& accessToken);
+    void setPaused(const bool& paused);
+    void viewed(const QString& path);
+    void fetch(const QString& path);
+
+    int getHits() const;
+    int getMisses() const;
+
+    Q_SIGNALS:
+        void pathPrefetched(const QString& path);
+        void pathListed(const QString& path);
+
+private slots:
+    void onTimeout();
+    void onFinished();
+
+private:
+    struct Folder {
+        QString path;
+        int depth;
+        bool demanded;
+    };
+
+    static Logger logger;
+
+    QDropboxCache* m_pCache;
+    QNetworkAccessManager m_network;
+    QNetworkConfigurationManager m_networkManager;
+    QTimer m_timer;
+    QString m_accessToken;
+    bool m_paused;
+
+    QQueue<Folder> m_queue;
+    QQueue<Folder> m_demand;
+    QSet<QString> m_queued;
+    QSet<QString> m_prefetched;
+    QNetworkReply* m_pReply;
+    Folder m_current;
+    QVariantList m_entries;
+    int m_budget;
+
+    int m_hits;
+    int m_misses;
+
+    void enqueueChildren(const QString& path, const int& depth);
+    void list(const QString& endpoint, const QByteArray& body);
+    void done();
+    bool isMetered();
+    bool isIdle();
+};
+
+#endif /* FOLDERPREFETCHER_HPP_ */
@@ -18,6 +18,8 @@
 Logger QDropboxCache::logger = Logger::getLogger("QDropboxCache");
 
 QDropboxCache::QDropboxCache(QObject* parent) : QObject(parent) {
+    DB::execute("CREATE INDEX IF NOT EXISTS files_content_hash_idx ON files (content_hash)");
+
     QVariantList list = DB::execute("SELECT * FROM paths_cursors").toList();
     foreach(QVariant v, list) {
         QVariantMap m = v.toMap();
@@ -101,8 +103,13 @@ void QDropboxCache::update(QDropboxFile* file) {
 }
 
 void QDropboxCache::deleteByPaths(const QStringList& paths) {
-    QString query = "DELETE FROM files WHERE path_display IN ('" + paths.join("','") + "')";
-    DB::execute(query);
+    DB::execute("BEGIN TRANSACTION");
+    foreach(QString p, paths) {
+        QVariantMap data;
+        data["path_display"] = p;
+        DB::execute("DELETE FROM files WHERE path_display = :path_display", data);
+    }
+    DB::execute("COMMIT");
 }
 
 void QDropboxCache::move(const QList<MoveEntry>& moveEntries) {
@@ -122,6 +129,28 @@ void QDropboxCache::move(const QList<MoveEntry>& moveEntries) {
     }
 }
 
+bool QDropboxCache::containsContentHash(const QString& contentHash, const QString& path) {
+    QVariantMap data;
+    data["content_hash"] = contentHash;
+    data["path"] = path.toLower();
+    QVariantList list = DB::execute("SELECT EXISTS (SELECT 1 FROM files WHERE content_hash = :content_hash AND LOWER(path) = :path) AS present", data).toList();
+    // not knowing reads as not present, the file is uploaded rather than skipped
+    if (DB::hasError() || list.isEmpty()) {
+        return false;
+    }
+    return list.first().toMap().value("present").toBool();
+}
+
+QString QDropboxCache::findContentHash(const QString& pathDisplay) {
+    QVariantMap data;
+    data["path_display"] = pathDisplay.toLower();
+    QVariantList list = DB::execute("SELECT content_hash FROM files WHERE LOWER(path_display) = :path_display", data).toList();
+    if (DB::hasError() || list.isEmpty()) {
+        return QString();
+    }
+    return list.first().toMap().value("content_hash").toString();
+}
+
 void QDropboxCache::flush() {
     DB::execute("DELETE FROM files");
     DB::execute("DELETE FROM paths_cursors");
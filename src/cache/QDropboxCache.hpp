@@ -48,6 +48,8 @@ public:
     void update(QDropboxFile* file);
     void deleteByPaths(const QStringList& paths);
     void move(const QList<MoveEntry>& moveEntries);
+    bool containsContentHash(const QString& contentHash, const QString& path);
+    QString findContentHash(const QString& pathDisplay);
 
     void flush();
 
@@ -10,7 +10,8 @@
 
 Logger QDropboxPoller::logger = Logger::getLogger("QDropboxPoller");
 
-QDropboxPoller::QDropboxPoller(QDropbox* qdropbox, QDropboxCache* cache, QObject* parent) : QObject(parent), m_pQDropbox(qdropbox), m_pCache(cache) {
+QDropboxPoller::QDropboxPoller(QDropbox* qdropbox, QDropboxCache* cache, QObject* parent) : QObject(parent), m_pQDropbox(qdropbox), m_pCache(cache),
+        m_pPollWait(Metrics::histogram("poll.wait_ms")), m_pQueueDepth(Metrics::gauge("poll.queue_depth")) {
     bool res = QObject::connect(m_pQDropbox, SIGNAL(listFolderLongPollFinished(const QString&, const bool&)), this, SLOT(onLongPoll(const QString&, const bool&)));
     Q_ASSERT(res);
     m_busy = false;
@@ -41,6 +42,7 @@ void QDropboxPoller::start() {
 
 void QDropboxPoller::onLongPoll(const QString& cursor, const bool& changes) {
     m_busy = false;
+    m_pPollWait->record((int) m_pollTimer.elapsed());
 
     if (changes) {
         bool res = QObject::connect(m_pQDropbox, SIGNAL(listFolderContinueLoaded(QList<QDropboxFile*>&, const QString&, const QString&, const bool&)), this, SLOT(onListFolderContinueLoaded(QList<QDropboxFile*>&, const QString&, const QString&, const bool&)));
@@ -64,8 +66,10 @@ void QDropboxPoller::poll() {
 }
 
 void QDropboxPoller::processQueue() {
+    m_pQueueDepth->set(m_queue.size());
     if (!m_busy && m_queue.size()) {
         m_busy = true;
+        m_pollTimer.start();
         m_pQDropbox->listFolderLongPoll(m_queue.head());
     }
 }
@@ -13,6 +13,8 @@
 #include <QTimer>
 #include "../Logger.hpp"
 #include <QQueue>
+#include <QElapsedTimer>
+#include "../util/Metrics.hpp"
 
 class QDropboxPoller: public QObject {
     Q_OBJECT
@@ -43,6 +45,10 @@ private:
     QQueue<QString> m_queue;
     bool m_busy;
 
+    QElapsedTimer m_pollTimer;
+    Histogram* m_pPollWait;
+    Gauge* m_pQueueDepth;
+
     void processQueue();
 };
 
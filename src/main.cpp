@@ -19,20 +19,23 @@
 
 #include <QLocale>
 #include <QTranslator>
-#include "vendor/Console.hpp"
+#include <QThreadPool>
+#include "LogQueue.hpp"
 
 using namespace bb;
 
 void myMessageOutput(QtMsgType type, const char* msg) {  // <-- ADD THIS
-    Q_UNUSED(type);
-    fprintf(stdout, "%s\n", msg);
-    fflush(stdout);
-
-    QSettings settings;
-    if (settings.value("sendToConsoleDebug", true).toBool()) {
-        Console* console = new Console();
-        console->sendMessage("ConsoleThis$$" + QString(msg));
-        console->deleteLater();
+    switch (type) {
+        case QtDebugMsg:
+            LogQueue::push(LOG_LEVEL_DEBUG, "", QString(msg));
+            break;
+        case QtWarningMsg:
+            LogQueue::push(LOG_LEVEL_WARN, "", QString(msg));
+            break;
+        default:
+            // Qt aborts right after a fatal message, the drain thread would never get to it
+            LogQueue::pushSync(LOG_LEVEL_ERROR, "", QString(msg));
+            break;
     }
 }
 
@@ -45,6 +48,15 @@ int main(int argc, char **argv) {
     QTextCodec::setCodecForCStrings(codec1);
 
     Application app(argc, argv);
-    Service srv;
-    return Application::exec();
+    LogQueue::start();
+
+    int res;
+    {
+        Service srv;
+        res = Application::exec();
+    }
+    // hashing and rescans may still be logging from the pool
+    QThreadPool::globalInstance()->waitForDone();
+    LogQueue::stop();
+    return res;
 }
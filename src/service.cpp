@@ -21,22 +21,33 @@
 #include <bb/platform/NotificationDefaultApplicationSettings>
 #include <bb/system/InvokeManager>
 #include <QDir>
-#include <QDirIterator>
 #include <QFile>
+#include <QFileInfo>
 #include <QTextStream>
 #include <QDataStream>
 #include <QSettings>
 #include <QUrl>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
+#include "util/ContentHasher.hpp"
+#include "Common.hpp"
+#include "LogQueue.hpp"
 
 #include <QTimer>
+#include <QElapsedTimer>
 
 #define AUTOLOAD_CAMERA_FILES_ENABLED "autoload.camera.files.enabled"
 #define AUTOLOAD_CAMERA_FILES_DISABLED "autoload.camera.files.disabled"
 #define CAMERA_DIR "/shared/camera"
+#define CAMERA_REMOTE_DIR "/Camera"
 #define INDEX_FILE_PLACE "/data/index"
 #define ACCESS_TOKEN_KEY "dropbox.access_token"
 #define DROPBOX_UPLOAD_SIZE 157286400 // 150 MB
 #define UPLOAD_SIZE (1048576 / 2) // 0.5 MB
+#define UPLOAD_NOTIFICATION_NAMES 10
+#define METRICS_FILE "/data/metrics.json"
+#define METRICS_INTERVAL 300000 // 5 min
+#define RSS_LOG_THRESHOLD (UPLOAD_SIZE * 16) // 8 MB, peak RSS is logged after bigger uploads
 
 using namespace bb::platform;
 using namespace bb::system;
@@ -48,18 +59,39 @@ Service::Service() :
         m_notify(new Notification(this)),
         m_invokeManager(new InvokeManager(this)),
         m_pWatcher(new QFileSystemWatcher(this)),
+        m_pDirWatcher(new Watcher(this)),
         m_pQdropbox(new QDropbox(this)),
+        m_pUploader(new QDropbox(this)),
         m_pDb(0),
         m_pCache(0),
         m_pPoller(0),
-        m_autoload(false) {
+        m_pPrefetcher(0),
+        m_pJournal(new UploadJournal(this)),
+        m_pRetryPolicy(new RetryPolicy(this)),
+        m_pShaper(new BandwidthShaper(this)),
+        m_pStability(new StabilityTracker(this)),
+        m_pDownloads(new DownloadManager(this)),
+        m_pThumbnails(new ThumbnailService(this)),
+        m_pFs(new FsWorker(this)),
+        m_pMetricsTimer(new QTimer(this)),
+        m_chunkBytes(0),
+        m_pUploadedKb(Metrics::counter("upload.kbytes")),
+        m_pChunkLatency(Metrics::histogram("upload.chunk_ms")),
+        m_pThroughput(Metrics::gauge("upload.throughput_kbps")),
+        m_pQueueDepth(Metrics::gauge("upload.queue_depth")),
+        m_autoload(false),
+        m_shapingScheduled(false),
+        m_uploadPending(false),
+        m_sharingFailed(0) {
 
     QCoreApplication::setOrganizationName("mikhail.chachkouski");
     QCoreApplication::setApplicationName("Basket");
 
     m_invokeManager->connect(m_invokeManager, SIGNAL(invoked(const bb::system::InvokeRequest&)), this, SLOT(handleInvoke(const bb::system::InvokeRequest&)));
 
-    bool res = QObject::connect(m_pWatcher, SIGNAL(directoryChanged(const QString&)), this, SLOT(onDirectoryChanged(const QString&)));
+    bool res = QObject::connect(m_pDirWatcher, SIGNAL(filesAdded(const QString&, const QStringList&)), this, SLOT(onWatchedFilesAdded(const QString&, const QStringList&)));
+    Q_ASSERT(res);
+    res = QObject::connect(m_pDirWatcher, SIGNAL(filesRemoved(const QString&, const QStringList&)), this, SLOT(onWatchedFilesRemoved(const QString&, const QStringList&)));
     Q_ASSERT(res);
     res = QObject::connect(m_pWatcher, SIGNAL(fileChanged(const QString&)), this, SLOT(onFileChanged(const QString&)));
     Q_ASSERT(res);
@@ -67,17 +99,20 @@ Service::Service() :
     Q_ASSERT(res);
     res = QObject::connect(m_pQdropbox, SIGNAL(error(QNetworkReply::NetworkError, const QString&)), this, SLOT(onError(QNetworkReply::NetworkError, const QString&)));
     Q_ASSERT(res);
-    res = QObject::connect(m_pQdropbox, SIGNAL(uploadSessionStarted(const QString&, const QString&)), this, SLOT(onUploadSessionStarted(const QString&, const QString&)));
+    // uploads have their own client, so errors of folder, URL or job requests never hit the upload in flight
+    res = QObject::connect(m_pUploader, SIGNAL(error(QNetworkReply::NetworkError, const QString&)), this, SLOT(onUploadError(QNetworkReply::NetworkError, const QString&)));
+    Q_ASSERT(res);
+    res = QObject::connect(m_pUploader, SIGNAL(uploadSessionStarted(const QString&, const QString&)), this, SLOT(onUploadSessionStarted(const QString&, const QString&)));
     Q_ASSERT(res);
-    res = QObject::connect(m_pQdropbox, SIGNAL(uploadSessionAppended(const QString&)), this, SLOT(onUploadSessionAppended(const QString&)));
+    res = QObject::connect(m_pUploader, SIGNAL(uploadSessionAppended(const QString&)), this, SLOT(onUploadSessionAppended(const QString&)));
     Q_ASSERT(res);
-    res = QObject::connect(m_pQdropbox, SIGNAL(uploadSessionFinished(QDropboxFile*)), this, SLOT(onUploadSessionFinished(QDropboxFile*)));
+    res = QObject::connect(m_pUploader, SIGNAL(uploadSessionFinished(QDropboxFile*)), this, SLOT(onUploadSessionFinished(QDropboxFile*)));
     Q_ASSERT(res);
-    res = QObject::connect(m_pQdropbox, SIGNAL(uploaded(QDropboxFile*)), this, SLOT(onUploaded(QDropboxFile*)));
+    res = QObject::connect(m_pUploader, SIGNAL(uploaded(QDropboxFile*)), this, SLOT(onUploaded(QDropboxFile*)));
     Q_ASSERT(res);
     res = QObject::connect(m_pQdropbox, SIGNAL(urlSaved()), this, SLOT(onUrlSaved()));
     Q_ASSERT(res);
-    res = QObject::connect(m_pQdropbox, SIGNAL(uploadFailed(const QString&)), this, SLOT(onUploadFailed(const QString&)));
+    res = QObject::connect(m_pUploader, SIGNAL(uploadFailed(const QString&)), this, SLOT(onUploadFailed(const QString&)));
     Q_ASSERT(res);
     res = QObject::connect(m_pQdropbox, SIGNAL(jobStatusChecked(const UnshareJobStatus&)), this, SLOT(onJobStatusChecked(const UnshareJobStatus&)));
     Q_ASSERT(res);
@@ -85,6 +120,16 @@ Service::Service() :
     Q_ASSERT(res);
     res = QObject::connect(this, SIGNAL(filesAdded(const QString&, const QStringList&)), this, SLOT(onFilesAdded(const QString&, const QStringList&)));
     Q_ASSERT(res);
+    res = QObject::connect(m_pStability, SIGNAL(stable(const QStringList&)), this, SLOT(onFilesStable(const QStringList&)));
+    Q_ASSERT(res);
+    res = QObject::connect(m_pMetricsTimer, SIGNAL(timeout()), this, SLOT(dumpMetrics()));
+    Q_ASSERT(res);
+    res = QObject::connect(m_pFs, SIGNAL(scanned(int, const QString&, const QStringList&)), this, SLOT(onIndexScanned(int, const QString&, const QStringList&)));
+    Q_ASSERT(res);
+    res = QObject::connect(m_pDownloads, SIGNAL(downloaded(const QString&, const QString&)), this, SLOT(onDownloaded(const QString&, const QString&)));
+    Q_ASSERT(res);
+    res = QObject::connect(m_pDownloads, SIGNAL(downloadFailed(const QString&, const QString&)), this, SLOT(onDownloadFailed(const QString&, const QString&)));
+    Q_ASSERT(res);
     Q_UNUSED(res);
 
     NotificationDefaultApplicationSettings settings;
@@ -106,21 +151,42 @@ Service::Service() :
     qsettings.sync();
     m_autoload = qsettings.value("autoload.camera.files", false).toBool();
     m_pQdropbox->setAccessToken(qsettings.value(ACCESS_TOKEN_KEY, "").toString());
+    m_pUploader->setAccessToken(qsettings.value(ACCESS_TOKEN_KEY, "").toString());
+    m_pDownloads->setAccessToken(qsettings.value(ACCESS_TOKEN_KEY, "").toString());
+    m_pThumbnails->setAccessToken(qsettings.value(ACCESS_TOKEN_KEY, "").toString());
+    m_pStability->setQuietPeriod(qsettings.value(AUTOLOAD_QUIET_PERIOD, 5000).toInt());
+    DB::setProfiling(qsettings.value(DB_PROFILING, false).toBool(), qsettings.value(DB_PROFILING_SLOW_MS, 50).toInt());
     m_pWatcher->addPath(qsettings.fileName());
 
     m_mode = Default;
 
+    restoreUploads();
+
+    m_pMetricsTimer->setInterval(METRICS_INTERVAL);
+    m_pMetricsTimer->start();
+
     logger.debug("Constructor called");
 }
 
 Service::~Service() {
     m_pWatcher->deleteLater();
+    m_pDirWatcher->deleteLater();
     m_invokeManager->deleteLater();
     m_notify->deleteLater();
     m_pQdropbox->deleteLater();
+    m_pUploader->deleteLater();
     m_pDb->deleteLater();
     m_pCache->deleteLater();
     m_pPoller->deleteLater();
+    m_pPrefetcher->deleteLater();
+    m_pJournal->deleteLater();
+    m_pRetryPolicy->deleteLater();
+    m_pShaper->deleteLater();
+    m_pStability->deleteLater();
+    m_pDownloads->deleteLater();
+    m_pThumbnails->deleteLater();
+    m_pFs->deleteLater();
+    m_pMetricsTimer->deleteLater();
 }
 
 void Service::handleInvoke(const bb::system::InvokeRequest& request) {
@@ -131,33 +197,47 @@ void Service::handleInvoke(const bb::system::InvokeRequest& request) {
     } else if (a.compare("chachkouski.BasketService.START") == 0) {
         initCache();
     } else if (a.compare("chachkouski.BasketService.UPLOAD_FILES") == 0) {
-        m_mode = SharingFiles;
-
         QByteArray data = request.data();
         QDataStream in(&data, QIODevice::ReadOnly);
         QVariantMap map;
         in >> map;
 
         QString path = map.value("path").toString();
-        QVariantList files = map.value("files").toList();
+        QStringList localPaths;
+        if (map.contains("manifest")) {
+            localPaths = readManifest(map.value("manifest").toString());
+        } else {
+            foreach(QVariant var, map.value("files").toList()) {
+                localPaths.append(QUrl::fromEncoded(var.toString().toAscii()).toString());
+            }
+        }
 
-        QString message = "Files will be uploaded:\n";
+        if (localPaths.isEmpty()) {
+            logger.warn("Nothing to upload");
+            return;
+        }
+        m_mode = SharingFiles;
 
-        foreach(QVariant var, files) {
-            QUrl url = QUrl::fromEncoded(var.toString().toAscii());
-            QString localPath = url.toString();
+        QList<QDropboxUpload> uploads;
+        QStringList names;
+        foreach(QString localPath, localPaths) {
             QString name = m_fileUtil.filename(localPath);
-            message.append("- " + name + "\n");
+            if (names.size() < UPLOAD_NOTIFICATION_NAMES) {
+                names.append("- " + name);
+            }
 
             QDropboxUpload upload(localPath, path + "/" + name, this);
             upload.setUploadSize(DROPBOX_UPLOAD_SIZE);
-            m_uploads.enqueue(upload);
-            if (m_uploads.size() == 1) {
-                processUploadsQueue();
-            }
+            uploads.append(upload);
+            m_sharing.insert(uploadKey(upload));
         }
+        enqueue(uploads, UploadQueue::Interactive);
+        startUploads();
 
-        m_notify->setBody(message);
+        if (localPaths.size() > names.size()) {
+            names.append("and " + QString::number(localPaths.size() - names.size()) + " more");
+        }
+        m_notify->setBody("Files will be uploaded:\n" + names.join("\n"));
         triggerNotification();
     } else if (a.compare("chachkouski.BasketService.SAVE_URL") == 0) {
         m_mode = SharingUrl;
@@ -188,6 +268,37 @@ void Service::handleInvoke(const bb::system::InvokeRequest& request) {
         m_pPoller->start();
     } else if (a.compare("chachkouski.BasketService.STOP_POLLING") == 0) {
         m_pPoller->stop();
+    } else if (a.compare("chachkouski.BasketService.DOWNLOAD_FILES") == 0) {
+        QByteArray data = request.data();
+        QDataStream in(&data, QIODevice::ReadOnly);
+        QVariantMap map;
+        in >> map;
+
+        m_pDownloads->download(map.value("paths").toStringList());
+    } else if (a.compare("chachkouski.BasketService.PREFETCH_THUMBNAILS") == 0) {
+        QByteArray data = request.data();
+        QDataStream in(&data, QIODevice::ReadOnly);
+        QVariantMap map;
+        in >> map;
+
+        initCache();
+        onPathChanged(map.value("path").toString());
+    } else if (a.compare("chachkouski.BasketService.PATH_VIEWED") == 0) {
+        QByteArray data = request.data();
+        QDataStream in(&data, QIODevice::ReadOnly);
+        QVariantMap map;
+        in >> map;
+
+        initCache();
+        m_pPrefetcher->viewed(map.value("path").toString());
+    } else if (a.compare("chachkouski.BasketService.METRICS") == 0) {
+        dumpMetrics();
+        logger.info(Metrics::snapshot());
+        if (DB::isProfiling()) {
+            logger.info(DB::profile());
+        }
+    } else if (a.compare("chachkouski.BasketService.RETRY_FAILED") == 0) {
+        retryFailedUploads();
     } else {
         initCache();
     }
@@ -211,6 +322,25 @@ void Service::onMetadataReceived(QDropboxFile* file) {
     file->deleteLater();
 }
 
+void Service::onDownloaded(const QString& remotePath, const QString& localPath) {
+    Q_UNUSED(remotePath);
+    Q_UNUSED(localPath);
+    if (m_pDownloads->isIdle()) {
+        m_notify->setBody("File(s) downloaded!");
+        triggerNotification();
+    }
+}
+
+void Service::onDownloadFailed(const QString& remotePath, const QString& reason) {
+    logger.error("Download failed: " + remotePath + ", " + reason);
+}
+
+void Service::onPathChanged(const QString& path) {
+    if (m_pCache != 0) {
+        m_pThumbnails->prefetch(m_pCache->findForPath(path).files);
+    }
+}
+
 void Service::onUrlSaved() {
     m_mode = Default;
     m_notify->setBody("URL saved!");
@@ -228,9 +358,70 @@ void Service::onTimeout() {
     m_notify->notify();
 }
 
-void Service::onDirectoryChanged(const QString& path) {
-    logger.debug("Dir changed: " + path);
-    updateIndex(path, m_paths.value(path));
+void Service::onWatchedFilesAdded(const QString& path, const QStringList& entries) {
+    logger.debug("Files added to " + path + ": " + QString::number(entries.size()));
+    if (!m_paths.contains(path)) {
+        return;
+    }
+
+    QStringList paths;
+    foreach(QString e, entries) {
+        paths.append(path + "/" + e);
+    }
+    updateIndex(path, m_paths.value(path), paths);
+}
+
+void Service::onWatchedFilesRemoved(const QString& path, const QStringList& entries) {
+    logger.debug("Files removed from " + path + ": " + QString::number(entries.size()));
+    if (!m_paths.contains(path)) {
+        return;
+    }
+
+    QStringList localPaths;
+    foreach(QString e, entries) {
+        QString localPath = path + "/" + e;
+        localPaths.append(localPath);
+
+        foreach(QDropboxUpload upload, m_uploads.removeByPath(localPath)) {
+            m_pJournal->remove(upload);
+        }
+    }
+    fileIndex(m_paths.value(path))->remove(localPaths);
+    m_pStability->untrack(localPaths);
+
+    QSettings qsettings;
+    if (qsettings.value(AUTOLOAD_PROPAGATE_DELETIONS, false).toBool()) {
+        QStringList remotePaths = uploadedRemotePaths(localPaths);
+        if (remotePaths.size()) {
+            logger.info("Deleting " + QString::number(remotePaths.size()) + " file(s) removed locally from Dropbox");
+            m_pQdropbox->deleteBatch(remotePaths);
+            if (m_pCache != 0) {
+                m_pCache->deleteByPaths(remotePaths);
+            }
+        }
+    }
+    m_pJournal->forgetUploaded(localPaths);
+}
+
+QStringList Service::uploadedRemotePaths(const QStringList& localPaths) {
+    // only what this service uploaded and what still has the content it uploaded, never a same-named file from elsewhere
+    QStringList remotePaths;
+    foreach(QString localPath, localPaths) {
+        QString remotePath;
+        QString contentHash;
+        if (!m_pJournal->findUploaded(localPath, remotePath, contentHash)) {
+            logger.debug("Not uploaded by this service, kept remotely: " + localPath);
+            continue;
+        }
+
+        QString remoteHash = m_pCache != 0 ? m_pCache->findContentHash(remotePath) : QString();
+        if (!remoteHash.isEmpty() && remoteHash.compare(contentHash) != 0) {
+            logger.info("Replaced remotely since upload, kept: " + remotePath);
+            continue;
+        }
+        remotePaths.append(remotePath);
+    }
+    return remotePaths;
 }
 
 void Service::onFileChanged(const QString& path) {
@@ -241,12 +432,21 @@ void Service::onFileChanged(const QString& path) {
 
         QString token = qsettings.value(ACCESS_TOKEN_KEY).toString();
         m_pQdropbox->setAccessToken(token);
+        m_pUploader->setAccessToken(token);
+        m_pDownloads->setAccessToken(token);
+        m_pThumbnails->setAccessToken(token);
+        if (m_pPrefetcher != 0) {
+            m_pPrefetcher->setAccessToken(token);
+        }
         if (token.isEmpty()) {
             m_autoload = false;
             qsettings.setValue("autoload.camera.files", m_autoload);
             qsettings.sync();
         }
 
+        m_pShaper->reload();
+        m_pStability->setQuietPeriod(qsettings.value(AUTOLOAD_QUIET_PERIOD, 5000).toInt());
+        DB::setProfiling(qsettings.value(DB_PROFILING, false).toBool(), qsettings.value(DB_PROFILING_SLOW_MS, 50).toInt());
         switchAutoload();
     }
 }
@@ -255,57 +455,38 @@ void Service::switchAutoload() {
     QString dir = QDir::currentPath() + CAMERA_DIR;
     QString name = dir.split("/").last();
     if (m_autoload) {
-        m_pQdropbox->createFolder("/Camera");
-        m_pWatcher->addPath(dir);
+        m_pQdropbox->createFolder(CAMERA_REMOTE_DIR);
         m_paths[dir] = name;
         removeIndex(name);
+        // the watcher is added once the index is rebuilt, see onIndexScanned
         createIndex(dir, name);
     } else {
-        m_pWatcher->removePath(dir);
+        m_pDirWatcher->unwatch(dir);
         removeIndex(m_paths.value(dir));
         m_paths.remove(dir);
     }
 }
 
-void Service::updateIndex(const QString& path, const QString& name) {
-    QString indexPath = QDir::currentPath() + INDEX_FILE_PLACE + "/" + name + ".txt";
-    int count = 0;
+void Service::updateIndex(const QString& path, const QString& name, const QStringList& entries) {
+    QElapsedTimer timer;
+    timer.start();
 
-    QFile index(indexPath);
-    index.open(QIODevice::ReadWrite | QIODevice::Text);
+    FileIndex* index = fileIndex(name);
+    int count = entries.size();
 
     QStringList added;
-    QDirIterator it(path, QDir::NoDotAndDotDot | QDir::Files);
-    QTextStream in(&index);
-
-    while(it.hasNext()) {
-        QString p = it.next();
-        count++;
-        in.seek(0);
-        bool found = false;
-        while(!in.atEnd()) {
-            QString line = in.readLine();
-            if (line.contains(p)) {
-                found = true;
-                break;
-            }
-        }
-
-        if (!found) {
+    foreach(QString p, entries) {
+        if (!index->contains(p)) {
             added.append(p);
         }
     }
 
     if (added.size()) {
-        QTextStream out(&index);
-        foreach(QString newPath, added) {
-            out << newPath << endl;
-        }
+        index->append(added);
         emit filesAdded(path, added);
     }
-    index.close();
 
-    logger.info("Index file updated: " + name + ", entries count: " + QString::number(count) + ", file size: " + QString::number(index.size()));
+    logger.info("Index updated: " + name + ", entries count: " + QString::number(count) + ", added: " + QString::number(added.size()) + ", took: " + QString::number(timer.elapsed()) + " ms");
 }
 
 void Service::createIndex(const QString& path, const QString& name) {
@@ -314,30 +495,50 @@ void Service::createIndex(const QString& path, const QString& name) {
         dir.mkpath(QDir::currentPath() + INDEX_FILE_PLACE);
     }
 
-    QString indexPath = QDir::currentPath() + INDEX_FILE_PLACE + "/" + name + ".txt";
-    int count = 0;
-
-    QFile index(indexPath);
-    index.open(QIODevice::WriteOnly | QIODevice::Text);
+    logger.info("Index scan requested: " + name + ", pending fs requests: " + QString::number(m_pFs->pending()));
+    m_pFs->scan(path);
+}
 
-    QDirIterator it(path, QDir::NoDotAndDotDot | QDir::Files);
-    QTextStream out(&index);
-    while(it.hasNext()) {
-        count++;
-        out << it.next() << endl;
+void Service::onIndexScanned(int id, const QString& path, const QStringList& files) {
+    Q_UNUSED(id);
+    if (!m_paths.contains(path)) {
+        // autoload was switched off while scanning
+        return;
     }
-    index.close();
 
-    logger.info("Index file created: " + name + ", entries count: " + QString::number(count) + ", file size: " + QString::number(index.size()));
+    QString name = m_paths.value(path);
+    FileIndex* index = fileIndex(name);
+    index->rewrite(files);
+    logger.info("Index created: " + name + ", entries count: " + QString::number(index->size()) +
+            ", fs queue latency avg: " + QString::number(m_pFs->getAverageQueueLatency()) + " ms, max: " + QString::number(m_pFs->getMaxQueueLatency()) + " ms");
+
+    // seeds the watcher from the same listing, the tree is not read twice
+    m_pDirWatcher->addPath(path, files);
 }
 
 void Service::removeIndex(const QString& name) {
-    QString indexPath = QDir::currentPath() + INDEX_FILE_PLACE + "/" + name + ".txt";
-    QFile index(indexPath);
-    if (index.exists()) {
-        index.remove();
+    FileIndex* index = m_indexes.take(name);
+    if (index != 0) {
+        index->deleteLater();
+    }
+
+    // requests run in order, so a following createIndex never sees these files
+    m_pFs->removeTree(indexPath(name));
+    m_pFs->removeTree(QDir::currentPath() + INDEX_FILE_PLACE + "/" + name + ".txt");
+    logger.debug("Index removal requested: " + name);
+}
+
+FileIndex* Service::fileIndex(const QString& name) {
+    if (!m_indexes.contains(name)) {
+        FileIndex* index = new FileIndex(indexPath(name), this);
+        index->load();
+        m_indexes[name] = index;
     }
-    logger.debug("Index file removed: " + name + ".txt");
+    return m_indexes.value(name);
+}
+
+QString Service::indexPath(const QString& name) const {
+    return QDir::currentPath() + INDEX_FILE_PLACE + "/" + name + ".idx";
 }
 
 void Service::onFolderCreated(QDropboxFile* folder) {
@@ -348,103 +549,475 @@ void Service::onFolderCreated(QDropboxFile* folder) {
 void Service::onError(QNetworkReply::NetworkError e, const QString& errorString) {
     logger.error(errorString);
     logger.error(e);
-    dequeue();
+    if (m_mode == SharingUrl) {
+        m_mode = Default;
+    }
+}
+
+void Service::onUploadError(QNetworkReply::NetworkError e, const QString& errorString) {
+    logger.error(errorString);
+    logger.error(e);
+    if (!settleRequest()) {
+        return;
+    }
+    retryUpload(errorString, RetryPolicy::isRetryable(e));
 }
 
 void Service::onUploadProgress(const QString& path, qint64 loaded, qint64 total) {
-    logger.debug("Progress for " + path + ": " + QString::number(loaded) + ", total: " + QString::number(total));
+    LOG_DEBUG(logger, "Progress for " + path + ": " + QString::number(loaded) + ", total: " + QString::number(total));
 }
 
 void Service::onUploadSessionStarted(const QString& remotePath, const QString& sessionId) {
+    if (!settleRequest()) {
+        return;
+    }
+    recordChunk();
     QDropboxUpload& upload = m_uploads.head();
     upload
         .setSessionId(sessionId)
         .increment();
+    m_pJournal->commit(upload);
     Q_UNUSED(remotePath);
     processUploadsQueue();
 }
 
 void Service::onUploadSessionAppended(const QString& sessionId) {
+    if (!settleRequest()) {
+        return;
+    }
+    recordChunk();
     QDropboxUpload& upload = m_uploads.head();
+    if (upload.getSessionId().compare(sessionId) != 0) {
+        logger.warn("Ack for another session ignored: " + sessionId);
+        retryUpload("Session mismatch", true);
+        return;
+    }
     upload.increment();
+    m_pJournal->commit(upload);
     processUploadsQueue();
-    Q_UNUSED(sessionId);
 }
 
 void Service::onUploadSessionFinished(QDropboxFile* file) {
-    m_pCache->add(file);
+    if (!settleRequest()) {
+        file->deleteLater();
+        return;
+    }
+    recordChunk();
+    if (m_pCache != 0) {
+        m_pCache->add(file);
+    }
     dequeue(file);
 }
 
 void Service::onUploaded(QDropboxFile* file) {
-    m_pCache->add(file);
+    if (!settleRequest()) {
+        file->deleteLater();
+        return;
+    }
+    recordChunk();
+    if (m_pCache != 0) {
+        m_pCache->add(file);
+    }
     dequeue(file);
  }
 
+bool Service::settleRequest() {
+    // one upload request is out at a time, anything arriving without it is a late answer to a request already given up on
+    if (!m_uploadPending || !m_uploads.hasCurrent()) {
+        logger.warn("Upload answer without a pending request ignored");
+        return false;
+    }
+    m_uploadPending = false;
+    return true;
+}
+
+void Service::startUploads() {
+    if (!m_uploads.hasCurrent()) {
+        processUploadsQueue();
+    }
+}
+
+void Service::enqueue(const QDropboxUpload& upload, UploadQueue::Priority priority) {
+    m_uploads.enqueue(upload, priority);
+    m_pJournal->add(upload, priority);
+    m_pQueueDepth->set(m_uploads.size());
+}
+
+void Service::enqueue(const QList<QDropboxUpload>& uploads, UploadQueue::Priority priority) {
+    if (uploads.isEmpty()) {
+        return;
+    }
+
+    foreach(QDropboxUpload upload, uploads) {
+        m_uploads.enqueue(upload, priority);
+    }
+    m_pJournal->add(uploads, priority);
+    m_pQueueDepth->set(m_uploads.size());
+}
+
+QStringList Service::readManifest(const QString& manifestPath) {
+    // one local path or file:// URL per line, read in a single pass
+    QStringList paths;
+    QFile manifest(manifestPath);
+    if (!manifest.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        logger.error("Cannot read upload manifest: " + manifestPath);
+        return paths;
+    }
+
+    QTextStream in(&manifest);
+    in.setCodec("UTF-8");
+    while (!in.atEnd()) {
+        QString line = in.readLine().trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+        paths.append(line.startsWith("file://") ? QUrl::fromEncoded(line.toAscii()).toLocalFile() : line);
+    }
+    manifest.close();
+
+    // the manifest is a one-off handover from the UI, but only files in our own data dir are ours to delete
+    QString dataDir = QFileInfo(QDir::currentPath() + "/data").canonicalFilePath() + "/";
+    if (QFileInfo(manifestPath).canonicalFilePath().startsWith(dataDir)) {
+        manifest.remove();
+    } else {
+        logger.warn("Upload manifest outside of the data dir is kept: " + manifestPath);
+    }
+    logger.info("Upload manifest read: " + QString::number(paths.size()) + " file(s)");
+    return paths;
+}
+
 void Service::processUploadsQueue() {
+    if (m_shapingScheduled) {
+        return;
+    }
+
+    if (m_pPrefetcher != 0) {
+        m_pPrefetcher->setPaused(true);
+    }
+
+    if (!m_uploads.next()) {
+        int wait = m_uploads.msUntilReady();
+        if (wait >= 0) {
+            QTimer::singleShot(wait, this, SLOT(startUploads()));
+        }
+        return;
+    }
+
+    int delay = m_pShaper->delay();
+    if (delay > 0) {
+        m_shapingScheduled = true;
+        QTimer::singleShot(delay, this, SLOT(onShapingTimeout()));
+        return;
+    }
+
     QDropboxUpload& upload = m_uploads.head();
     if (upload.getSize() == 0) {
         upload.resize();
     }
-    if (upload.getSize() <= upload.getUploadSize()) {
+
+    // a single request reads the whole file into memory, so anything above one chunk goes
+    // through a session of mapped chunks, which also lets the shaper pace it
+    if (upload.getSize() <= upload.getUploadSize() && upload.getSize() <= UPLOAD_SIZE) {
+        m_pShaper->consume(upload.getSize());
+        startChunk(upload.getSize());
         QFile* file = new QFile(upload.getPath());
-        m_pQdropbox->upload(file, upload.getRemotePath());
+        m_uploadPending = true;
+        m_pUploader->upload(file, upload.getRemotePath());
     } else {
         if (upload.isNew()) {
             upload.setUploadSize(UPLOAD_SIZE);
-            m_pQdropbox->uploadSessionStart(upload.getRemotePath(), upload.next());
+            m_uploadPending = true;
+            m_pUploader->uploadSessionStart(upload.getRemotePath(), nextChunk(upload));
         } else {
             qint64 offset = upload.getOffset();
-            if (upload.lastPortion()) {
-                m_pQdropbox->uploadSessionFinish(upload.getSessionId(), upload.next(), offset, upload.getRemotePath());
+            if (upload.lastPortion() && changedWhileUploading(upload)) {
+                // never commit a stale copy, the upload of the new content would land next to it as a conflicted copy
+                logger.warn("File changed while uploading, dropping the session, will upload again: " + upload.getPath());
+                m_pStability->addWastedBytes(offset);
+                m_pStability->track(QStringList() << upload.getPath());
+                dequeue();
+            } else if (upload.lastPortion()) {
+                m_uploadPending = true;
+                m_pUploader->uploadSessionFinish(upload.getSessionId(), nextChunk(upload), offset, upload.getRemotePath());
             } else {
-                m_pQdropbox->uploadSessionAppend(upload.getSessionId(), upload.next(), offset);
+                m_uploadPending = true;
+                m_pUploader->uploadSessionAppend(upload.getSessionId(), nextChunk(upload), offset);
             }
         }
     }
 }
 
+void Service::onShapingTimeout() {
+    m_shapingScheduled = false;
+    if (m_uploads.size()) {
+        processUploadsQueue();
+    }
+}
+
+QByteArray Service::nextChunk(QDropboxUpload& upload) {
+    qint64 size = qMin(upload.getUploadSize(), upload.getSize() - upload.getOffset());
+    m_pShaper->consume(size);
+    startChunk(size);
+    QByteArray chunk = m_chunkReader.read(upload.getPath(), upload.getOffset(), size);
+    m_chunkReader.prefetch(upload.getPath(), upload.getOffset(), upload.getUploadSize(), upload.getSize());
+    return chunk;
+}
+
+void Service::startChunk(const qint64& bytes) {
+    m_chunkBytes = bytes;
+    m_chunkTimer.start();
+}
+
+void Service::recordChunk() {
+    if (m_chunkBytes == 0) {
+        return;
+    }
+
+    qint64 elapsed = qMax(m_chunkTimer.elapsed(), (qint64) 1);
+    m_pChunkLatency->record((int) elapsed);
+    m_pUploadedKb->add((int) (m_chunkBytes / 1024));
+    m_pThroughput->set((int) (m_chunkBytes * 1000 / 1024 / elapsed));
+    m_chunkBytes = 0;
+}
+
+void Service::dumpMetrics() {
+    m_pQueueDepth->set(m_uploads.size());
+    Metrics::gauge("fs.pending")->set(m_pFs->pending());
+    Metrics::gauge("fs.queue_latency_avg_ms")->set((int) m_pFs->getAverageQueueLatency());
+    Metrics::gauge("log.dropped")->set(LogQueue::dropped());
+
+    QVariantMap snapshot = Metrics::snapshot();
+    if (DB::isProfiling()) {
+        snapshot["statements"] = DB::profile();
+    }
+
+    if (!Metrics::dump(QDir::currentPath() + METRICS_FILE, snapshot)) {
+        logger.warn("Cannot write metrics to " + QString(METRICS_FILE));
+    }
+}
+
 void Service::dequeue(QDropboxFile* file) {
     if (file != 0) {
         logger.info("File uploaded: " + file->getPathDisplay());
         logger.info("File size: " + QString::number(file->getSize()));
         file->deleteLater();
+
+        if (m_uploads.hasCurrent()) {
+            m_pRetryPolicy->reset(uploadKey(m_uploads.head()));
+            m_pJournal->uploaded(m_uploads.head().getPath(), file->getPathDisplay(), file->getContentHash());
+        }
     }
 
-    if (m_uploads.size()) {
+    m_chunkReader.release();
+
+    if (m_uploads.hasCurrent()) {
+        QDropboxUpload& upload = m_uploads.head();
+        if (file != 0 && changedWhileUploading(upload)) {
+            // only a single request upload gets here, sessions are dropped before the commit
+            logger.warn("File changed right after its upload, the new content is not uploaded: " + upload.getPath());
+            m_pStability->addWastedBytes(upload.getSize());
+        }
+        if (upload.getSize() > RSS_LOG_THRESHOLD) {
+            logger.info("Peak RSS after upload of " + upload.getPath() + ": " + QString::number(ChunkReader::peakRss()) + " KB");
+        }
+        if (m_sharing.remove(uploadKey(upload)) && file == 0) {
+            m_sharingFailed++;
+        }
+        m_pJournal->remove(upload);
         m_uploads.dequeue();
+        m_pQueueDepth->set(m_uploads.size());
         logger.debug("upload dequeued");
     }
 
+    // a failed share may sit in the retry class, so wait for every shared file to settle
+    if (m_mode == SharingFiles && m_sharing.isEmpty()) {
+        if (m_sharingFailed) {
+            m_notify->setBody(QString::number(m_sharingFailed) + " file(s) could not be uploaded");
+        } else {
+            m_notify->setBody("File(s) uploaded!");
+        }
+        triggerNotification();
+        m_sharingFailed = 0;
+        m_mode = Default;
+    }
+
     if (m_uploads.size()) {
         processUploadsQueue();
     } else {
-        if (m_mode == SharingFiles) {
-            m_notify->setBody("File(s) uploaded!");
-            triggerNotification();
+        m_mode = Default;
+        if (m_pPrefetcher != 0) {
+            m_pPrefetcher->setPaused(false);
         }
+    }
+}
 
-        m_mode = Default;
+bool Service::changedWhileUploading(const QDropboxUpload& upload) {
+    // shares are uploaded as they were when shared
+    if (m_uploads.currentPriority() == UploadQueue::Interactive || upload.getSize() == 0) {
+        return false;
     }
+    return QFileInfo(upload.getPath()).size() != upload.getSize();
 }
 
 void Service::onFilesAdded(const QString& path, const QStringList& files) {
-    foreach(QString localPath, files) {
-        QString name = m_fileUtil.filename(localPath);
-        logger.debug("Will upload file " + name + " to /Camera/");
+    Q_UNUSED(path);
+    m_pStability->track(files);
+}
+
+void Service::onFilesStable(const QStringList& files) {
+    // a headless start after boot has seen no invoke yet, the dedupe still needs the cache
+    if (m_pCache == 0) {
+        initCache();
+    }
+
+    // hashing runs off the main thread, cache lookups happen back here in onFilesHashed
+    QFutureWatcher<QStringList>* watcher = new QFutureWatcher<QStringList>(this);
+    watcher->setProperty("files", files);
+    bool res = QObject::connect(watcher, SIGNAL(finished()), this, SLOT(onFilesHashed()));
+    Q_ASSERT(res);
+    Q_UNUSED(res);
+    watcher->setFuture(QtConcurrent::run(&ContentHasher::hashAll, files));
+}
 
-        QDropboxUpload upload(localPath, "/Camera/" + name, this);
-        m_uploads.enqueue(upload);
-        if (m_uploads.size() == 1) {
-            QTimer::singleShot(5000, this, SLOT(processUploadsQueue()));
+void Service::onFilesHashed() {
+    QFutureWatcher<QStringList>* watcher = static_cast<QFutureWatcher<QStringList>*>(QObject::sender());
+    QStringList files = watcher->property("files").toStringList();
+    QStringList hashes = watcher->result();
+    watcher->deleteLater();
+
+    QStringList ready;
+    QStringList readyHashes;
+    for (int i = 0; i < files.size(); i++) {
+        QString hash = hashes.value(i);
+        QString remoteDir = cameraRemotePath(files.at(i)).section('/', 0, -2);
+        if (!hash.isEmpty() && m_pPrefetcher != 0 && m_pCache->findCursor(remoteDir).isEmpty()) {
+            // destination was never listed (fresh install, flushed cache), list it before checking
+            m_unlisted.insert(files.at(i), hash);
+            if (!m_listing.contains(remoteDir.toLower())) {
+                m_listing.insert(remoteDir.toLower());
+                m_pPrefetcher->fetch(remoteDir);
+            }
+        } else {
+            ready.append(files.at(i));
+            readyHashes.append(hash);
         }
     }
-    Q_UNUSED(path);
+    enqueueAutoload(skipUploaded(ready, readyHashes));
+}
+
+void Service::onPathListed(const QString& path) {
+    QString key = path.toLower();
+    if (!m_listing.remove(key)) {
+        return;
+    }
+
+    QStringList files;
+    QStringList hashes;
+    foreach(QString localPath, m_unlisted.keys()) {
+        if (cameraRemotePath(localPath).section('/', 0, -2).toLower() == key) {
+            files.append(localPath);
+            hashes.append(m_unlisted.take(localPath));
+        }
+    }
+    enqueueAutoload(skipUploaded(files, hashes));
+}
+
+QStringList Service::skipUploaded(const QStringList& files, const QStringList& hashes) {
+    QStringList toUpload;
+    qint64 skippedBytes = 0;
+    for (int i = 0; i < files.size(); i++) {
+        QString hash = hashes.value(i);
+        QString remoteDir = cameraRemotePath(files.at(i)).section('/', 0, -2);
+        if (m_pCache != 0 && !hash.isEmpty() && m_pCache->containsContentHash(hash, remoteDir)) {
+            logger.info("Same content already in " + remoteDir + ", skipping: " + files.at(i));
+            skippedBytes += QFileInfo(files.at(i)).size();
+        } else {
+            toUpload.append(files.at(i));
+        }
+    }
+
+    if (skippedBytes) {
+        logger.info("Skipped " + QString::number(files.size() - toUpload.size()) + " file(s), " + QString::number(skippedBytes) + " bytes");
+    }
+    return toUpload;
+}
+
+void Service::enqueueAutoload(const QStringList& files) {
+    QList<QDropboxUpload> uploads;
+    foreach(QString localPath, files) {
+        QString remotePath = cameraRemotePath(localPath);
+        logger.debug("Will upload file " + localPath + " to " + remotePath);
+
+        uploads.append(QDropboxUpload(localPath, remotePath, this));
+    }
+    if (uploads.size()) {
+        enqueue(uploads, UploadQueue::Autoload);
+        startUploads();
+    }
+}
+
+QString Service::cameraRemotePath(const QString& localPath) {
+    // keeps subfolders of the camera dir, so equally named files in different folders do not collide
+    QString cameraDir = QDir::currentPath() + CAMERA_DIR + "/";
+    if (localPath.startsWith(cameraDir)) {
+        return QString(CAMERA_REMOTE_DIR) + "/" + localPath.mid(cameraDir.length());
+    }
+    return QString(CAMERA_REMOTE_DIR) + "/" + m_fileUtil.filename(localPath);
 }
 
 void Service::onUploadFailed(const QString& reason) {
     logger.error(reason);
-    dequeue();
+    if (!settleRequest()) {
+        return;
+    }
+    retryUpload(reason, RetryPolicy::isRetryable(reason));
+}
+
+void Service::retryUpload(const QString& reason, bool retryable) {
+    m_chunkBytes = 0;
+    if (!m_uploads.hasCurrent()) {
+        return;
+    }
+
+    // only called once the request was answered, QNAM no longer reads the mapped chunk
+    m_chunkReader.release();
+
+    // offset is advanced only on acknowledged chunks, so the retry resumes from the last confirmed one
+    QDropboxUpload& upload = m_uploads.head();
+    QString key = uploadKey(upload);
+    if (retryable && m_pRetryPolicy->shouldRetry(key)) {
+        // backoff happens in the retry class, other uploads go on meanwhile
+        m_uploads.requeue(UploadQueue::Retry, m_pRetryPolicy->nextDelay(key));
+        m_pJournal->setPriority(upload, UploadQueue::Retry);
+        Metrics::counter("upload.retries")->add();
+        QTimer::singleShot(0, this, SLOT(startUploads()));
+    } else {
+        m_pRetryPolicy->failed(key);
+        Metrics::counter("upload.failures")->add();
+        m_pJournal->fail(upload, reason);
+        dequeue();
+    }
+}
+
+void Service::retryFailedUploads() {
+    QList<JournalEntry> failed = m_pJournal->failedEntries();
+    m_pJournal->clearFailed();
+
+    foreach(JournalEntry e, failed) {
+        if (!QFile::exists(e.localPath)) {
+            continue;
+        }
+        QDropboxUpload upload(e.localPath, e.remotePath, this);
+        upload.setUploadSize(DROPBOX_UPLOAD_SIZE);
+        enqueue(upload, UploadQueue::Retry);
+    }
+    logger.info("Failed uploads requeued: " + QString::number(failed.size()));
+
+    startUploads();
+}
+
+QString Service::uploadKey(const QDropboxUpload& upload) const {
+    return upload.getPath() + " -> " + upload.getRemotePath();
 }
 
 void Service::initCache() {
@@ -458,6 +1031,56 @@ void Service::initCache() {
 
     if (m_pPoller == 0) {
         m_pPoller = new QDropboxPoller(m_pQdropbox, m_pCache, this);
+        bool res = QObject::connect(m_pPoller, SIGNAL(pathChanged(const QString&)), this, SLOT(onPathChanged(const QString&)));
+        Q_ASSERT(res);
+        Q_UNUSED(res);
 //        m_pPoller->start();
     }
+
+    if (m_pPrefetcher == 0) {
+        QSettings qsettings;
+        m_pPrefetcher = new FolderPrefetcher(m_pCache, this);
+        m_pPrefetcher->setAccessToken(qsettings.value(ACCESS_TOKEN_KEY, "").toString());
+        m_pPrefetcher->setPaused(m_uploads.size() != 0);
+        bool res = QObject::connect(m_pPrefetcher, SIGNAL(pathPrefetched(const QString&)), this, SLOT(onPathChanged(const QString&)));
+        Q_ASSERT(res);
+        res = QObject::connect(m_pPrefetcher, SIGNAL(pathListed(const QString&)), this, SLOT(onPathListed(const QString&)));
+        Q_ASSERT(res);
+        Q_UNUSED(res);
+    }
+}
+
+void Service::restoreUploads() {
+    QSettings qsettings;
+    if (qsettings.value(ACCESS_TOKEN_KEY, "").toString().isEmpty()) {
+        return;
+    }
+
+    QList<JournalEntry> entries = m_pJournal->entries();
+    foreach(JournalEntry e, entries) {
+        if (!QFile::exists(e.localPath)) {
+            logger.warn("Journaled file is gone, skipping: " + e.localPath);
+            QDropboxUpload upload(e.localPath, e.remotePath, this);
+            m_pJournal->remove(upload);
+            continue;
+        }
+
+        QDropboxUpload upload(e.localPath, e.remotePath, this);
+        upload.setUploadSize(DROPBOX_UPLOAD_SIZE);
+        if (e.state == JournalEntry::InProgress && !e.sessionId.isEmpty()) {
+            upload.resize();
+            upload.setUploadSize(UPLOAD_SIZE);
+            upload
+                .setSessionId(e.sessionId)
+                .setOffset(e.offset);
+            logger.info("Resuming upload session for " + e.localPath + " from offset " + QString::number(e.offset));
+        } else {
+            logger.info("Restoring pending upload: " + e.localPath);
+        }
+        m_uploads.enqueue(upload, (UploadQueue::Priority) e.priority);
+    }
+
+    if (m_uploads.size()) {
+        QTimer::singleShot(5000, this, SLOT(startUploads()));
+    }
 }
@@ -19,17 +19,33 @@
 
 #include <QObject>
 #include "Logger.hpp"
+#include "Watcher.hpp"
 #include <QFileSystemWatcher>
 #include <QMap>
 #include <qdropbox/QDropbox.hpp>
 #include <qdropbox/QDropboxFile.hpp>
 #include <qdropbox/QDropboxUpload.hpp>
 #include <QQueue>
+#include <QSet>
+#include <QTimer>
+#include <QElapsedTimer>
 #include <QStringList>
 #include "util/FileUtil.hpp"
+#include "util/FileIndex.hpp"
+#include "util/DownloadManager.hpp"
+#include "util/ThumbnailService.hpp"
+#include "util/FsWorker.hpp"
+#include "util/Metrics.hpp"
 #include "cache/DB.hpp"
 #include "cache/QDropboxCache.hpp"
 #include "cache/QDropboxPoller.hpp"
+#include "cache/FolderPrefetcher.hpp"
+#include "upload/UploadJournal.hpp"
+#include "upload/ChunkReader.hpp"
+#include "upload/RetryPolicy.hpp"
+#include "upload/BandwidthShaper.hpp"
+#include "upload/UploadQueue.hpp"
+#include "upload/StabilityTracker.hpp"
 
 namespace bb {
     class Application;
@@ -60,10 +76,12 @@ public:
 private slots:
     void handleInvoke(const bb::system::InvokeRequest &);
     void onTimeout();
-    void onDirectoryChanged(const QString& path);
+    void onWatchedFilesAdded(const QString& path, const QStringList& entries);
+    void onWatchedFilesRemoved(const QString& path, const QStringList& entries);
     void onFileChanged(const QString& path);
     void onFolderCreated(QDropboxFile* folder);
     void onError(QNetworkReply::NetworkError e, const QString& errorString);
+    void onUploadError(QNetworkReply::NetworkError e, const QString& errorString);
     void onUploadProgress(const QString& path, qint64 loaded, qint64 total);
     void onUploadSessionStarted(const QString& remotePath, const QString& sessionId);
     void onUploadSessionAppended(const QString& sessionId);
@@ -75,29 +93,83 @@ private slots:
     void onUploadFailed(const QString& reason);
     void onJobStatusChecked(const UnshareJobStatus& status);
     void onMetadataReceived(QDropboxFile* file);
+    void startUploads();
+    void onFilesHashed();
+    void onPathListed(const QString& path);
+    void onFilesStable(const QStringList& files);
+    void onDownloaded(const QString& remotePath, const QString& localPath);
+    void onDownloadFailed(const QString& remotePath, const QString& reason);
+    void onPathChanged(const QString& path);
+    void onIndexScanned(int id, const QString& path, const QStringList& files);
+    void dumpMetrics();
+    void onShapingTimeout();
 
 private:
     void triggerNotification();
     void switchAutoload();
-    void updateIndex(const QString& path, const QString& name);
+    void updateIndex(const QString& path, const QString& name, const QStringList& entries);
     void createIndex(const QString& path, const QString& name);
     void removeIndex(const QString& name);
+    FileIndex* fileIndex(const QString& name);
+    QString indexPath(const QString& name) const;
     void dequeue(QDropboxFile* file = 0);
     void initCache();
+    void restoreUploads();
+    QByteArray nextChunk(QDropboxUpload& upload);
+    void startChunk(const qint64& bytes);
+    void recordChunk();
+    void retryUpload(const QString& reason, bool retryable);
+    bool settleRequest();
+    bool changedWhileUploading(const QDropboxUpload& upload);
+    void enqueue(const QDropboxUpload& upload, UploadQueue::Priority priority);
+    void enqueue(const QList<QDropboxUpload>& uploads, UploadQueue::Priority priority);
+    QStringList readManifest(const QString& manifestPath);
+    QStringList skipUploaded(const QStringList& files, const QStringList& hashes);
+    void enqueueAutoload(const QStringList& files);
+    QString cameraRemotePath(const QString& localPath);
+    QStringList uploadedRemotePaths(const QStringList& localPaths);
+    void retryFailedUploads();
+    QString uploadKey(const QDropboxUpload& upload) const;
 
     bb::platform::Notification * m_notify;
     bb::system::InvokeManager * m_invokeManager;
     QFileSystemWatcher* m_pWatcher;
+    Watcher* m_pDirWatcher;
     QDropbox* m_pQdropbox;
+    QDropbox* m_pUploader;
     DB* m_pDb;
     QDropboxCache* m_pCache;
     QDropboxPoller* m_pPoller;
+    FolderPrefetcher* m_pPrefetcher;
+    UploadJournal* m_pJournal;
+    RetryPolicy* m_pRetryPolicy;
+    BandwidthShaper* m_pShaper;
+    StabilityTracker* m_pStability;
+    DownloadManager* m_pDownloads;
+    ThumbnailService* m_pThumbnails;
+    FsWorker* m_pFs;
+    QTimer* m_pMetricsTimer;
 
-    QQueue<QDropboxUpload> m_uploads;
+    QElapsedTimer m_chunkTimer;
+    qint64 m_chunkBytes;
+    Counter* m_pUploadedKb;
+    Histogram* m_pChunkLatency;
+    Gauge* m_pThroughput;
+    Gauge* m_pQueueDepth;
+
+    UploadQueue m_uploads;
     bool m_autoload;
+    bool m_shapingScheduled;
+    bool m_uploadPending;
     QMap<QString, QString> m_paths;
+    QMap<QString, FileIndex*> m_indexes;
     FileUtil m_fileUtil;
+    ChunkReader m_chunkReader;
     Mode m_mode;
+    QSet<QString> m_sharing;
+    int m_sharingFailed;
+    QMap<QString, QString> m_unlisted;
+    QSet<QString> m_listing;
 
     QMap<QString, QString> m_sharedFolderIds;
     QMap<QString, UnshareJobStatus> m_jobStatuses;
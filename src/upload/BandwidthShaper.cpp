@@ -0,0 +1,108 @@
+/*
+ * BandwidthShaper.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#include "BandwidthShaper.hpp"
+#include <QSettings>
+#include <QTime>
+#include <QNetworkConfiguration>
+#include <bb/device/BatteryInfo>
+#include <bb/device/BatteryChargingState>
+#include "../Common.hpp"
+
+#define BURST_SECONDS 2
+
+using namespace bb::device;
+
+Logger BandwidthShaper::logger = Logger::getLogger("BandwidthShaper");
+
+BandwidthShaper::BandwidthShaper(QObject* parent) : QObject(parent), m_pBattery(new BatteryInfo(this)), m_tokens(0),
+        m_wifiRate(0), m_cellularRate(0), m_fullSpeedCharging(false), m_fullSpeedFrom(-1), m_fullSpeedTo(-1) {
+    m_clock.start();
+    reload();
+}
+
+BandwidthShaper::~BandwidthShaper() {
+    m_pBattery->deleteLater();
+}
+
+void BandwidthShaper::reload() {
+    QSettings qsettings;
+    m_wifiRate = qsettings.value(UPLOADS_RATE_WIFI, 0).toLongLong() * 1024;
+    m_cellularRate = qsettings.value(UPLOADS_RATE_CELLULAR, 0).toLongLong() * 1024;
+    m_fullSpeedCharging = qsettings.value(UPLOADS_FULL_SPEED_CHARGING, false).toBool();
+    m_fullSpeedFrom = qsettings.value(UPLOADS_FULL_SPEED_FROM, -1).toInt();
+    m_fullSpeedTo = qsettings.value(UPLOADS_FULL_SPEED_TO, -1).toInt();
+
+    logger.info("Upload rates, wifi: " + QString::number(m_wifiRate) + " B/s, cellular: " + QString::number(m_cellularRate) + " B/s");
+}
+
+bool BandwidthShaper::isLimited() {
+    return rate() > 0;
+}
+
+int BandwidthShaper::delay() {
+    qint64 r = rate();
+    if (r <= 0) {
+        m_tokens = 0;
+        return 0;
+    }
+
+    refill();
+    if (m_tokens >= 0) {
+        return 0;
+    }
+    return (int) ((-m_tokens * 1000) / r) + 1;
+}
+
+void BandwidthShaper::consume(const qint64& bytes) {
+    if (isLimited()) {
+        refill();
+        m_tokens -= bytes;
+    }
+}
+
+void BandwidthShaper::refill() {
+    qint64 elapsed = m_clock.restart();
+    qint64 r = rate();
+    m_tokens = qMin(m_tokens + (elapsed * r) / 1000, r * BURST_SECONDS);
+}
+
+qint64 BandwidthShaper::rate() {
+    if (isFullSpeed()) {
+        return 0;
+    }
+    return isCellular() ? m_cellularRate : m_wifiRate;
+}
+
+bool BandwidthShaper::isCellular() {
+    switch (m_networkManager.defaultConfiguration().bearerType()) {
+        case QNetworkConfiguration::BearerWLAN:
+        case QNetworkConfiguration::BearerEthernet:
+        case QNetworkConfiguration::BearerUnknown:
+            return false;
+        default:
+            return true;
+    }
+}
+
+bool BandwidthShaper::isFullSpeed() {
+    if (m_fullSpeedCharging) {
+        BatteryChargingState::Type state = m_pBattery->chargingState();
+        if (state == BatteryChargingState::Charging || state == BatteryChargingState::Full) {
+            return true;
+        }
+    }
+
+    if (m_fullSpeedFrom >= 0 && m_fullSpeedTo >= 0) {
+        int hour = QTime::currentTime().hour();
+        if (m_fullSpeedFrom <= m_fullSpeedTo) {
+            return hour >= m_fullSpeedFrom && hour < m_fullSpeedTo;
+        }
+        return hour >= m_fullSpeedFrom || hour < m_fullSpeedTo;
+    }
+    return false;
+}
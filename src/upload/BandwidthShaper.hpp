@@ -0,0 +1,59 @@
+/*
+ * BandwidthShaper.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#ifndef BANDWIDTHSHAPER_HPP_
+#define BANDWIDTHSHAPER_HPP_
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QNetworkConfigurationManager>
+#include "../Logger.hpp"
+
+namespace bb {
+    namespace device {
+        class BatteryInfo;
+    }
+}
+
+/**
+ * Token bucket shared by every upload request. Bytes are taken when a request
+ * is dispatched and the bucket may go into debt, so a large request delays the
+ * following ones instead of being split. Rate depends on the active bearer
+ * (Wi-Fi or cellular) and on the configured full speed schedule.
+ */
+class BandwidthShaper: public QObject {
+    Q_OBJECT
+public:
+    BandwidthShaper(QObject* parent = 0);
+    virtual ~BandwidthShaper();
+
+    void reload();
+    bool isLimited();
+    int delay();
+    void consume(const qint64& bytes);
+
+private:
+    static Logger logger;
+
+    QNetworkConfigurationManager m_networkManager;
+    bb::device::BatteryInfo* m_pBattery;
+    QElapsedTimer m_clock;
+
+    qint64 m_tokens;
+    qint64 m_wifiRate;
+    qint64 m_cellularRate;
+    bool m_fullSpeedCharging;
+    int m_fullSpeedFrom;
+    int m_fullSpeedTo;
+
+    qint64 rate();
+    bool isCellular();
+    bool isFullSpeed();
+    void refill();
+};
+
+#endif /* BANDWIDTHSHAPER_HPP_ */
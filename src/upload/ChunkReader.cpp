@@ -0,0 +1,120 @@
+/*
+ * ChunkReader.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#include "ChunkReader.hpp"
+#include <sys/resource.h>
+#include <fcntl.h>
+#include <QtConcurrentRun>
+
+#define PREFETCH_DEPTH 2
+#define WARM_UP_BUFFER_SIZE 65536
+
+Logger ChunkReader::logger = Logger::getLogger("ChunkReader");
+
+ChunkReader::ChunkReader(QObject* parent) : QObject(parent), m_pMap(0) {}
+
+ChunkReader::~ChunkReader() {
+    foreach(QFuture<void> f, m_prefetches) {
+        f.waitForFinished();
+    }
+    release();
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+}
+
+QByteArray ChunkReader::read(const QString& path, const qint64& offset, const qint64& size) {
+    release();
+
+    if (m_file.fileName().compare(path) != 0 || !m_file.isOpen()) {
+        if (m_file.isOpen()) {
+            m_file.close();
+        }
+        m_file.setFileName(path);
+        if (!m_file.open(QIODevice::ReadOnly)) {
+            logger.error("Cannot open file for upload: " + path);
+            return QByteArray();
+        }
+    }
+
+    m_pMap = m_file.map(offset, size);
+    if (m_pMap != 0) {
+        return QByteArray::fromRawData(reinterpret_cast<const char*>(m_pMap), (int) size);
+    }
+
+    logger.warn("Cannot map " + path + ", falling back to read: " + m_file.errorString());
+    m_file.seek(offset);
+    return m_file.read(size);
+}
+
+void ChunkReader::release() {
+    if (m_pMap != 0) {
+        m_file.unmap(m_pMap);
+        m_pMap = 0;
+    }
+}
+
+void ChunkReader::prefetch(const QString& path, const qint64& offset, const qint64& chunkSize, const qint64& fileSize) {
+    if (m_prefetchPath.compare(path) != 0) {
+        m_prefetchPath = path;
+        m_prefetched.clear();
+    }
+
+    QList<QFuture<void> > running;
+    foreach(QFuture<void> f, m_prefetches) {
+        if (f.isRunning()) {
+            running.append(f);
+        }
+    }
+    m_prefetches = running;
+
+    for (int i = 1; i <= PREFETCH_DEPTH && m_prefetches.size() < PREFETCH_DEPTH; i++) {
+        qint64 next = offset + chunkSize * i;
+        if (next >= fileSize) {
+            break;
+        }
+        if (m_prefetched.contains(next)) {
+            continue;
+        }
+        m_prefetched.insert(next);
+#ifdef POSIX_FADV_WILLNEED
+        // only a hint to the kernel, it does the readahead into the page cache the map will use
+        if (m_file.isOpen() && m_file.fileName().compare(path) == 0) {
+            posix_fadvise(m_file.handle(), next, qMin(chunkSize, fileSize - next), POSIX_FADV_WILLNEED);
+            continue;
+        }
+#endif
+        m_prefetches.append(QtConcurrent::run(&ChunkReader::warmUp, path, next, qMin(chunkSize, fileSize - next)));
+    }
+}
+
+void ChunkReader::warmUp(const QString& path, const qint64& offset, const qint64& size) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly) || !file.seek(offset)) {
+        return;
+    }
+
+    // pool threads have small stacks, keep the buffer on the heap
+    QByteArray buffer(WARM_UP_BUFFER_SIZE, Qt::Uninitialized);
+    qint64 left = size;
+    while (left > 0) {
+        qint64 read = file.read(buffer.data(), qMin((qint64) WARM_UP_BUFFER_SIZE, left));
+        if (read <= 0) {
+            break;
+        }
+        left -= read;
+    }
+    file.close();
+}
+
+qint64 ChunkReader::peakRss() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        return usage.ru_maxrss;
+    }
+    return -1;
+}
@@ -0,0 +1,53 @@
+/*
+ * ChunkReader.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#ifndef CHUNKREADER_HPP_
+#define CHUNKREADER_HPP_
+
+#include <QObject>
+#include <QFile>
+#include <QByteArray>
+#include <QFuture>
+#include <QList>
+#include <QSet>
+#include "../Logger.hpp"
+
+/**
+ * Serves upload chunks straight from a memory-mapped region of the file.
+ * Returned QByteArray does not own the data, so the region stays mapped until
+ * the next read() or release(). Caller must not touch the chunk after that.
+ *
+ * prefetch() asks the kernel to read the following chunks ahead (posix_fadvise),
+ * so mapping chunk N+1 does not stall on disk while chunk N is on the wire.
+ * Where fadvise is missing the pages are warmed by a read on a pool thread.
+ */
+class ChunkReader: public QObject {
+    Q_OBJECT
+public:
+    ChunkReader(QObject* parent = 0);
+    virtual ~ChunkReader();
+
+    QByteArray read(const QString& path, const qint64& offset, const qint64& size);
+    void release();
+    void prefetch(const QString& path, const qint64& offset, const qint64& chunkSize, const qint64& fileSize);
+
+    static qint64 peakRss();
+
+private:
+    static Logger logger;
+
+    QFile m_file;
+    uchar* m_pMap;
+
+    QString m_prefetchPath;
+    QSet<qint64> m_prefetched;
+    QList<QFuture<void> > m_prefetches;
+
+    static void warmUp(const QString& path, const qint64& offset, const qint64& size);
+};
+
+#endif /* CHUNKREADER_HPP_ */
@@ -0,0 +1,80 @@
+/*
+ * RetryPolicy.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#include "RetryPolicy.hpp"
+#include <QDateTime>
+#include <QStringList>
+
+#define MAX_ATTEMPTS 6
+#define BASE_DELAY 2000 // 2 sec
+#define MAX_DELAY 600000 // 10 min
+
+Logger RetryPolicy::logger = Logger::getLogger("RetryPolicy");
+
+RetryPolicy::RetryPolicy(QObject* parent) : QObject(parent), m_maxAttempts(MAX_ATTEMPTS), m_baseDelay(BASE_DELAY), m_maxDelay(MAX_DELAY) {
+    qsrand(QDateTime::currentDateTime().toTime_t());
+}
+
+RetryPolicy::~RetryPolicy() {}
+
+bool RetryPolicy::shouldRetry(const QString& key) {
+    return m_attempts.value(key, 0) < m_maxAttempts;
+}
+
+int RetryPolicy::nextDelay(const QString& key) {
+    int attempt = m_attempts.value(key, 0);
+    m_attempts[key] = attempt + 1;
+
+    qint64 delay = (qint64) m_baseDelay << qMin(attempt, 16);
+    if (delay > m_maxDelay) {
+        delay = m_maxDelay;
+    }
+    // full jitter on the upper half, so parallel failures do not retry in lockstep
+    delay = delay / 2 + qrand() % (delay / 2 + 1);
+
+    logger.info("Retry " + QString::number(attempt + 1) + " of " + QString::number(m_maxAttempts) + " for " + key + " in " + QString::number(delay) + " ms");
+    return (int) delay;
+}
+
+void RetryPolicy::reset(const QString& key) {
+    m_attempts.remove(key);
+}
+
+int RetryPolicy::attempts(const QString& key) const {
+    return m_attempts.value(key, 0);
+}
+
+void RetryPolicy::failed(const QString& key) {
+    logger.warn("Giving up on " + key + " after " + QString::number(m_attempts.value(key, 0)) + " retries");
+    m_attempts.remove(key);
+}
+
+bool RetryPolicy::isRetryable(QNetworkReply::NetworkError e) {
+    switch (e) {
+        case QNetworkReply::ContentAccessDenied:
+        case QNetworkReply::ContentOperationNotPermittedError:
+        case QNetworkReply::ContentNotFoundError:
+        case QNetworkReply::AuthenticationRequiredError:
+        case QNetworkReply::ProtocolInvalidOperationError:
+            return false;
+        default:
+            return true;
+    }
+}
+
+
+bool RetryPolicy::isRetryable(const QString& reason) {
+    // Dropbox error summaries that no retry can fix
+    static QStringList permanent = QStringList() << "conflict" << "insufficient_space" << "disallowed_name" << "malformed_path"
+            << "no_write_permission" << "too_large" << "invalid_access_token";
+    foreach(QString summary, permanent) {
+        if (reason.contains(summary)) {
+            return false;
+        }
+    }
+    return true;
+}
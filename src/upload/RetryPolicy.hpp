@@ -0,0 +1,46 @@
+/*
+ * RetryPolicy.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#ifndef RETRYPOLICY_HPP_
+#define RETRYPOLICY_HPP_
+
+#include <QObject>
+#include <QMap>
+#include <QNetworkReply>
+#include "../Logger.hpp"
+
+/**
+ * Exponential backoff with jitter for failed uploads.
+ * Attempts are counted per upload key (local path + remote path).
+ */
+class RetryPolicy: public QObject {
+    Q_OBJECT
+public:
+    RetryPolicy(QObject* parent = 0);
+    virtual ~RetryPolicy();
+
+    bool shouldRetry(const QString& key);
+    int nextDelay(const QString& key);
+    void reset(const QString& key);
+    int attempts(const QString& key) const;
+
+    static bool isRetryable(QNetworkReply::NetworkError e);
+    static bool isRetryable(const QString& reason);
+
+    void failed(const QString& key);
+
+private:
+    static Logger logger;
+
+    int m_maxAttempts;
+    int m_baseDelay;
+    int m_maxDelay;
+
+    QMap<QString, int> m_attempts;
+};
+
+#endif /* RETRYPOLICY_HPP_ */
@@ -0,0 +1,91 @@
+/*
+ * StabilityTracker.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#include "StabilityTracker.hpp"
+#include <QDateTime>
+#include "../util/Metrics.hpp"
+
+#define CHECK_INTERVAL 1000
+#define DEFAULT_QUIET_PERIOD 5000
+
+Logger StabilityTracker::logger = Logger::getLogger("StabilityTracker");
+
+StabilityTracker::StabilityTracker(QObject* parent) : QObject(parent), m_quietPeriod(DEFAULT_QUIET_PERIOD), m_wastedBytes(0), m_heldBack(0) {
+    m_timer.setInterval(CHECK_INTERVAL);
+    bool res = QObject::connect(&m_timer, SIGNAL(timeout()), this, SLOT(onTimeout()));
+    Q_ASSERT(res);
+    Q_UNUSED(res);
+}
+
+StabilityTracker::~StabilityTracker() {
+    m_timer.stop();
+}
+
+void StabilityTracker::track(const QStringList& paths) {
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    foreach(QString p, paths) {
+        Tracked t;
+        DirSnapshot::stat(p, t.entry);
+        t.lastChange = now;
+        m_files[p] = t;
+    }
+
+    if (!m_files.isEmpty() && !m_timer.isActive()) {
+        m_timer.start();
+    }
+}
+
+void StabilityTracker::untrack(const QStringList& paths) {
+    foreach(QString p, paths) {
+        m_files.remove(p);
+    }
+}
+
+void StabilityTracker::setQuietPeriod(const int& quietPeriod) {
+    m_quietPeriod = quietPeriod;
+}
+
+void StabilityTracker::onTimeout() {
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QStringList ready;
+
+    foreach(QString p, m_files.keys()) {
+        Tracked& t = m_files[p];
+        SnapshotEntry current;
+        if (!DirSnapshot::stat(p, current)) {
+            m_files.remove(p);
+            continue;
+        }
+
+        if (current != t.entry) {
+            if (!t.changed) {
+                t.changed = true;
+                m_heldBack++;
+                Metrics::counter("autoload.held_back")->add();
+            }
+            t.entry = current;
+            t.lastChange = now;
+        } else if (now - t.lastChange >= m_quietPeriod) {
+            ready.append(p);
+            m_files.remove(p);
+        }
+    }
+
+    if (m_files.isEmpty()) {
+        m_timer.stop();
+    }
+
+    if (ready.size()) {
+        emit stable(ready);
+    }
+}
+
+void StabilityTracker::addWastedBytes(const qint64& bytes) {
+    m_wastedBytes += bytes;
+    Metrics::counter("autoload.wasted_kbytes")->add((int) (bytes / 1024));
+    logger.info("Bytes wasted on files changed during upload: " + QString::number(m_wastedBytes) + ", files held back while changing: " + QString::number(m_heldBack));
+}
@@ -0,0 +1,61 @@
+/*
+ * StabilityTracker.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#ifndef STABILITYTRACKER_HPP_
+#define STABILITYTRACKER_HPP_
+
+#include <QObject>
+#include <QMap>
+#include <QStringList>
+#include <QTimer>
+#include "../Logger.hpp"
+#include "../util/DirSnapshot.hpp"
+
+/**
+ * Holds new files back until their size and mtime stopped changing for a quiet
+ * period, so videos still being recorded are not uploaded truncated.
+ * Files held back and bytes wasted on files that changed during upload are published
+ * as the autoload.held_back and autoload.wasted_kbytes counters.
+ */
+class StabilityTracker: public QObject {
+    Q_OBJECT
+public:
+    StabilityTracker(QObject* parent = 0);
+    virtual ~StabilityTracker();
+
+    void track(const QStringList& paths);
+    void untrack(const QStringList& paths);
+    void setQuietPeriod(const int& quietPeriod);
+
+    void addWastedBytes(const qint64& bytes);
+
+    Q_SIGNALS:
+        void stable(const QStringList& paths);
+
+private slots:
+    void onTimeout();
+
+private:
+    struct Tracked {
+        SnapshotEntry entry;
+        qint64 lastChange;
+        bool changed;
+
+        Tracked() : lastChange(0), changed(false) {}
+    };
+
+    static Logger logger;
+
+    QTimer m_timer;
+    QMap<QString, Tracked> m_files;
+    int m_quietPeriod;
+
+    qint64 m_wastedBytes;
+    int m_heldBack;
+};
+
+#endif /* STABILITYTRACKER_HPP_ */
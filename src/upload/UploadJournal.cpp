@@ -0,0 +1,216 @@
+/*
+ * UploadJournal.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#include "UploadJournal.hpp"
+#include <QDir>
+#include <QDateTime>
+#include "../Common.hpp"
+
+#define JOURNAL_NAME "uploads.db"
+#define SCHEMA_VERSION 1
+
+using namespace bb::data;
+
+Logger UploadJournal::logger = Logger::getLogger("UploadJournal");
+
+UploadJournal::UploadJournal(QObject* parent) : QObject(parent) {
+    QString dirPath = QDir::currentPath() + CACHE_DIR;
+    QDir dir(dirPath);
+    if (!dir.exists()) {
+        dir.mkpath(dirPath);
+    }
+
+    m_pSda = new SqlDataAccess(dirPath + "/" + JOURNAL_NAME, this);
+    createSchema();
+}
+
+UploadJournal::~UploadJournal() {
+    m_pSda->deleteLater();
+}
+
+void UploadJournal::add(const QDropboxUpload& upload, const int& priority) {
+    QVariantMap data;
+    data["local_path"] = upload.getPath();
+    data["remote_path"] = upload.getRemotePath();
+    data["state"] = (int) JournalEntry::Pending;
+    data["priority"] = priority;
+    data["created_at"] = QDateTime::currentDateTime().toTime_t();
+    execute("INSERT OR REPLACE INTO uploads (local_path, remote_path, session_id, offset, state, priority, created_at) "
+            "VALUES (:local_path, :remote_path, '', 0, :state, :priority, :created_at)", data);
+}
+
+void UploadJournal::add(const QList<QDropboxUpload>& uploads, const int& priority) {
+    // one transaction instead of one fsync per row
+    execute("BEGIN TRANSACTION");
+    foreach(QDropboxUpload upload, uploads) {
+        add(upload, priority);
+    }
+    execute("COMMIT");
+}
+
+void UploadJournal::commit(const QDropboxUpload& upload) {
+    QVariantMap data;
+    data["local_path"] = upload.getPath();
+    data["remote_path"] = upload.getRemotePath();
+    data["session_id"] = upload.getSessionId();
+    data["offset"] = upload.getOffset();
+    data["state"] = (int) JournalEntry::InProgress;
+    execute("UPDATE uploads SET session_id = :session_id, offset = :offset, state = :state "
+            "WHERE local_path = :local_path AND remote_path = :remote_path", data);
+}
+
+void UploadJournal::setPriority(const QDropboxUpload& upload, const int& priority) {
+    QVariantMap data;
+    data["local_path"] = upload.getPath();
+    data["remote_path"] = upload.getRemotePath();
+    data["priority"] = priority;
+    execute("UPDATE uploads SET priority = :priority WHERE local_path = :local_path AND remote_path = :remote_path", data);
+}
+
+void UploadJournal::remove(const QDropboxUpload& upload) {
+    QVariantMap data;
+    data["local_path"] = upload.getPath();
+    data["remote_path"] = upload.getRemotePath();
+    execute("DELETE FROM uploads WHERE local_path = :local_path AND remote_path = :remote_path", data);
+}
+
+QList<JournalEntry> UploadJournal::entries() {
+    QList<JournalEntry> entries;
+    QVariantList list = execute("SELECT * FROM uploads ORDER BY created_at ASC, rowid ASC").toList();
+    foreach(QVariant v, list) {
+        QVariantMap m = v.toMap();
+        JournalEntry e;
+        e.localPath = m.value("local_path").toString();
+        e.remotePath = m.value("remote_path").toString();
+        e.sessionId = m.value("session_id").toString();
+        e.offset = m.value("offset").toLongLong();
+        e.state = (JournalEntry::State) m.value("state").toInt();
+        e.priority = m.value("priority").toInt();
+        entries.append(e);
+    }
+    return entries;
+}
+
+void UploadJournal::clear() {
+    execute("DELETE FROM uploads");
+}
+
+void UploadJournal::fail(const QDropboxUpload& upload, const QString& reason) {
+    QVariantMap data;
+    data["local_path"] = upload.getPath();
+    data["remote_path"] = upload.getRemotePath();
+    data["reason"] = reason;
+    data["failed_at"] = QDateTime::currentDateTime().toTime_t();
+    execute("INSERT OR REPLACE INTO failed_uploads (local_path, remote_path, reason, failed_at) "
+            "VALUES (:local_path, :remote_path, :reason, :failed_at)", data);
+    remove(upload);
+}
+
+QList<JournalEntry> UploadJournal::failedEntries() {
+    QList<JournalEntry> entries;
+    QVariantList list = execute("SELECT * FROM failed_uploads ORDER BY failed_at ASC").toList();
+    foreach(QVariant v, list) {
+        QVariantMap m = v.toMap();
+        JournalEntry e;
+        e.localPath = m.value("local_path").toString();
+        e.remotePath = m.value("remote_path").toString();
+        entries.append(e);
+    }
+    return entries;
+}
+
+void UploadJournal::clearFailed() {
+    execute("DELETE FROM failed_uploads");
+}
+
+void UploadJournal::uploaded(const QString& localPath, const QString& remotePath, const QString& contentHash) {
+    QVariantMap data;
+    data["local_path"] = localPath;
+    data["remote_path"] = remotePath;
+    data["content_hash"] = contentHash;
+    data["uploaded_at"] = QDateTime::currentDateTime().toTime_t();
+    execute("INSERT OR REPLACE INTO uploaded_files (local_path, remote_path, content_hash, uploaded_at) "
+            "VALUES (:local_path, :remote_path, :content_hash, :uploaded_at)", data);
+}
+
+bool UploadJournal::findUploaded(const QString& localPath, QString& remotePath, QString& contentHash) {
+    QVariantMap data;
+    data["local_path"] = localPath;
+    QVariantList list = execute("SELECT remote_path, content_hash FROM uploaded_files WHERE local_path = :local_path", data).toList();
+    if (list.isEmpty()) {
+        return false;
+    }
+    remotePath = list.first().toMap().value("remote_path").toString();
+    contentHash = list.first().toMap().value("content_hash").toString();
+    return true;
+}
+
+void UploadJournal::forgetUploaded(const QStringList& localPaths) {
+    execute("BEGIN");
+    foreach(QString localPath, localPaths) {
+        QVariantMap data;
+        data["local_path"] = localPath;
+        execute("DELETE FROM uploaded_files WHERE local_path = :local_path", data);
+    }
+    execute("COMMIT");
+}
+
+void UploadJournal::createSchema() {
+    execute("PRAGMA synchronous = FULL");
+    execute("CREATE TABLE IF NOT EXISTS uploads ("
+            "local_path TEXT NOT NULL, "
+            "remote_path TEXT NOT NULL, "
+            "session_id TEXT, "
+            "offset INTEGER NOT NULL DEFAULT 0, "
+            "state INTEGER NOT NULL DEFAULT 0, "
+            "priority INTEGER NOT NULL DEFAULT 0, "
+            "created_at INTEGER, "
+            "PRIMARY KEY (local_path, remote_path))");
+    execute("CREATE TABLE IF NOT EXISTS failed_uploads ("
+            "local_path TEXT NOT NULL, "
+            "remote_path TEXT NOT NULL, "
+            "reason TEXT, "
+            "failed_at INTEGER, "
+            "PRIMARY KEY (local_path, remote_path))");
+    execute("CREATE TABLE IF NOT EXISTS uploaded_files ("
+            "local_path TEXT PRIMARY KEY, "
+            "remote_path TEXT NOT NULL, "
+            "content_hash TEXT, "
+            "uploaded_at INTEGER)");
+    migrate();
+}
+
+void UploadJournal::migrate() {
+    int version = execute("PRAGMA user_version").toList().value(0).toMap().value("user_version").toInt();
+    if (version >= SCHEMA_VERSION) {
+        return;
+    }
+
+    if (version < 1) {
+        // journals from before priority classes were created without the column
+        bool hasPriority = false;
+        foreach(QVariant v, execute("PRAGMA table_info(uploads)").toList()) {
+            if (v.toMap().value("name").toString().compare("priority") == 0) {
+                hasPriority = true;
+            }
+        }
+        if (!hasPriority) {
+            execute("ALTER TABLE uploads ADD COLUMN priority INTEGER NOT NULL DEFAULT 0");
+            logger.info("Upload journal migrated: priority column added");
+        }
+    }
+
+    execute("PRAGMA user_version = " + QString::number(SCHEMA_VERSION));
+}
+
+QVariant UploadJournal::execute(const QString& query, const QVariantMap& data) {
+    QVariant result = data.isEmpty() ? m_pSda->execute(query) : m_pSda->execute(query, data);
+    if (m_pSda->hasError()) {
+        logger.error(m_pSda->error().errorMessage());
+    }
+    return result;
+}
@@ -0,0 +1,73 @@
+/*
+ * UploadJournal.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#ifndef UPLOADJOURNAL_HPP_
+#define UPLOADJOURNAL_HPP_
+
+#include <QObject>
+#include <QList>
+#include <bb/data/SqlDataAccess>
+#include <qdropbox/QDropboxUpload.hpp>
+#include "../Logger.hpp"
+
+struct JournalEntry {
+    enum State {
+        Pending = 0,
+        InProgress = 1
+    };
+
+    QString localPath;
+    QString remotePath;
+    QString sessionId;
+    qint64 offset;
+    State state;
+    int priority;
+
+    JournalEntry() : offset(0), state(Pending), priority(0) {}
+};
+
+/**
+ * Persistent record of queued uploads, kept in its own SQLite file next to the cache.
+ * The committed offset is written only after Dropbox acknowledged the chunk,
+ * so after a restart a session can be continued from that offset.
+ * Uploads which ran out of retries are moved to a separate failed list.
+ * Finished uploads are remembered with the remote path and content_hash they got, so
+ * only files this service uploaded are ever deleted remotely.
+ */
+class UploadJournal: public QObject {
+    Q_OBJECT
+public:
+    UploadJournal(QObject* parent = 0);
+    virtual ~UploadJournal();
+
+    void add(const QDropboxUpload& upload, const int& priority);
+    void add(const QList<QDropboxUpload>& uploads, const int& priority);
+    void commit(const QDropboxUpload& upload);
+    void setPriority(const QDropboxUpload& upload, const int& priority);
+    void remove(const QDropboxUpload& upload);
+    QList<JournalEntry> entries();
+    void clear();
+
+    void fail(const QDropboxUpload& upload, const QString& reason);
+    QList<JournalEntry> failedEntries();
+    void clearFailed();
+
+    void uploaded(const QString& localPath, const QString& remotePath, const QString& contentHash);
+    bool findUploaded(const QString& localPath, QString& remotePath, QString& contentHash);
+    void forgetUploaded(const QStringList& localPaths);
+
+private:
+    static Logger logger;
+
+    bb::data::SqlDataAccess* m_pSda;
+
+    void createSchema();
+    void migrate();
+    QVariant execute(const QString& query, const QVariantMap& data = QVariantMap());
+};
+
+#endif /* UPLOADJOURNAL_HPP_ */
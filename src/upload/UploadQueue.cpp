@@ -0,0 +1,159 @@
+/*
+ * UploadQueue.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#include "UploadQueue.hpp"
+#include <QDateTime>
+#include <limits.h>
+
+#define AGING_STEP 600000 // 10 min of waiting is worth one priority class
+
+Logger UploadQueue::logger = Logger::getLogger("UploadQueue");
+
+UploadQueue::UploadQueue(QObject* parent) : QObject(parent), m_current(-1) {
+    m_pLatency[Interactive] = Metrics::histogram("upload.latency.interactive");
+    m_pLatency[Autoload] = Metrics::histogram("upload.latency.autoload");
+    m_pLatency[Retry] = Metrics::histogram("upload.latency.retry");
+}
+
+UploadQueue::~UploadQueue() {}
+
+void UploadQueue::enqueue(const QDropboxUpload& upload, Priority priority, const int& delay) {
+    qint64 t = now();
+    m_entries.append(Entry(upload, priority, t, t + delay));
+}
+
+bool UploadQueue::next() {
+    if (m_current != -1) {
+        return true;
+    }
+
+    qint64 t = now();
+    qint64 bestRank = 0;
+    for (int i = 0; i < m_entries.size(); i++) {
+        const Entry& e = m_entries.at(i);
+        if (e.readyAt > t) {
+            continue;
+        }
+
+        // age counts from readyAt, so a requeued retry starts over behind fresh work.
+        // The credit stops short of class 0, nothing can overtake an interactive share
+        qint64 base = (qint64) e.priority * AGING_STEP;
+        qint64 credit = qMin(t - e.readyAt, qMax(base - 1, (qint64) 0));
+        qint64 rank = base - credit;
+        if (m_current == -1 || rank < bestRank) {
+            m_current = i;
+            bestRank = rank;
+        }
+    }
+    return m_current != -1;
+}
+
+bool UploadQueue::hasCurrent() const {
+    return m_current != -1;
+}
+
+QDropboxUpload& UploadQueue::head() {
+    Q_ASSERT(m_current != -1);
+    return m_entries[m_current].upload;
+}
+
+UploadQueue::Priority UploadQueue::currentPriority() const {
+    return m_entries.at(m_current).priority;
+}
+
+void UploadQueue::dequeue() {
+    if (m_current == -1) {
+        return;
+    }
+
+    const Entry& e = m_entries.at(m_current);
+    qint64 latency = now() - e.enqueuedAt;
+    Latency& l = m_latency[e.priority];
+    l.total += latency;
+    l.count++;
+    if (latency > l.max) {
+        l.max = latency;
+    }
+    m_pLatency[e.priority]->record((int) qMin(latency, (qint64) INT_MAX));
+    logger.info("Upload latency: " + QString::number(latency) + " ms, class: " + QString::number(e.priority) +
+            ", avg: " + QString::number(getAverageLatency(e.priority)) + " ms, max: " + QString::number(l.max) + " ms");
+
+    m_entries.removeAt(m_current);
+    m_current = -1;
+}
+
+void UploadQueue::requeue(Priority priority, const int& delay) {
+    if (m_current == -1) {
+        return;
+    }
+
+    Entry& e = m_entries[m_current];
+    e.priority = priority;
+    e.readyAt = now() + delay;
+    m_current = -1;
+}
+
+int UploadQueue::msUntilReady() const {
+    qint64 t = now();
+    qint64 earliest = -1;
+    foreach(const Entry& e, m_entries) {
+        if (earliest == -1 || e.readyAt < earliest) {
+            earliest = e.readyAt;
+        }
+    }
+    if (earliest == -1) {
+        return -1;
+    }
+    return (int) qMax((qint64) 0, earliest - t);
+}
+
+QList<QDropboxUpload> UploadQueue::removeByPath(const QString& localPath) {
+    QList<QDropboxUpload> removed;
+    for (int i = m_entries.size() - 1; i >= 0; i--) {
+        if (i == m_current || m_entries.at(i).upload.getPath().compare(localPath) != 0) {
+            continue;
+        }
+
+        removed.append(m_entries.at(i).upload);
+        m_entries.removeAt(i);
+        if (m_current > i) {
+            m_current--;
+        }
+    }
+    return removed;
+}
+
+int UploadQueue::size() const {
+    return m_entries.size();
+}
+
+bool UploadQueue::isEmpty() const {
+    return m_entries.isEmpty();
+}
+
+int UploadQueue::size(Priority priority) const {
+    int count = 0;
+    foreach(const Entry& e, m_entries) {
+        if (e.priority == priority) {
+            count++;
+        }
+    }
+    return count;
+}
+
+qint64 UploadQueue::getAverageLatency(Priority priority) const {
+    const Latency& l = m_latency[priority];
+    return l.count ? l.total / l.count : 0;
+}
+
+qint64 UploadQueue::getMaxLatency(Priority priority) const {
+    return m_latency[priority].max;
+}
+
+qint64 UploadQueue::now() {
+    return QDateTime::currentMSecsSinceEpoch();
+}
@@ -0,0 +1,83 @@
+/*
+ * UploadQueue.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#ifndef UPLOADQUEUE_HPP_
+#define UPLOADQUEUE_HPP_
+
+#include <QObject>
+#include <QList>
+#include <qdropbox/QDropboxUpload.hpp>
+#include "../Logger.hpp"
+#include "../util/Metrics.hpp"
+
+/**
+ * Upload queue with priority classes: interactive shares go first, then camera
+ * autoload, then retries. Waiting time lowers the rank of an entry, so a long
+ * waiting retry can get ahead of fresh autoload, but aging is capped so nothing
+ * ever gets ahead of an interactive share.
+ *
+ * Only one upload is in flight. It is pinned by next() and stays head() until
+ * dequeue() or requeue(), even if something more important arrives meanwhile.
+ */
+class UploadQueue: public QObject {
+    Q_OBJECT
+public:
+    enum Priority {
+        Interactive = 0,
+        Autoload = 1,
+        Retry = 2
+    };
+
+    UploadQueue(QObject* parent = 0);
+    virtual ~UploadQueue();
+
+    void enqueue(const QDropboxUpload& upload, Priority priority, const int& delay = 0);
+    bool next();
+    bool hasCurrent() const;
+    QDropboxUpload& head();
+    Priority currentPriority() const;
+    void dequeue();
+    void requeue(Priority priority, const int& delay);
+    int msUntilReady() const;
+    QList<QDropboxUpload> removeByPath(const QString& localPath);
+
+    int size() const;
+    bool isEmpty() const;
+    int size(Priority priority) const;
+
+    qint64 getAverageLatency(Priority priority) const;
+    qint64 getMaxLatency(Priority priority) const;
+
+private:
+    struct Entry {
+        QDropboxUpload upload;
+        Priority priority;
+        qint64 enqueuedAt;
+        qint64 readyAt;
+
+        Entry(const QDropboxUpload& u, Priority p, qint64 enqueued, qint64 ready) : upload(u), priority(p), enqueuedAt(enqueued), readyAt(ready) {}
+    };
+
+    struct Latency {
+        qint64 total;
+        qint64 max;
+        int count;
+
+        Latency() : total(0), max(0), count(0) {}
+    };
+
+    static Logger logger;
+
+    QList<Entry> m_entries;
+    int m_current;
+    Latency m_latency[3];
+    Histogram* m_pLatency[3];
+
+    static qint64 now();
+};
+
+#endif /* UPLOADQUEUE_HPP_ */
@@ -0,0 +1,135 @@
+/*
+ * BlobCache.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#include "BlobCache.hpp"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDirIterator>
+#include <QMultiMap>
+#include <QDateTime>
+#include <utime.h>
+#include "Metrics.hpp"
+
+#define PART_SUFFIX ".part"
+
+Logger BlobCache::logger = Logger::getLogger("BlobCache");
+
+BlobCache::BlobCache(const QString& root, const qint64& budget, QObject* parent) : QObject(parent), m_root(root), m_budget(budget), m_size(-1),
+        m_hits(0), m_misses(0), m_evictions(0), m_evictedBytes(0) {}
+
+BlobCache::~BlobCache() {}
+
+QString BlobCache::pathFor(const QString& contentHash, const QString& rev, const QString& name) const {
+    // keyed by name alone, equally named files from different folders would share an entry
+    if (!contentHash.isEmpty()) {
+        return m_root + "/" + contentHash + "/" + name;
+    }
+    if (!rev.isEmpty()) {
+        return m_root + "/rev-" + rev + "/" + name;
+    }
+    return QString();
+}
+
+bool BlobCache::lookup(const QString& path) {
+    if (QFile::exists(path)) {
+        m_hits++;
+        Metrics::counter("blobcache.hits")->add();
+        touch(path);
+        return true;
+    }
+
+    m_misses++;
+    Metrics::counter("blobcache.misses")->add();
+    QDir dir(QFileInfo(path).absolutePath());
+    if (!dir.exists()) {
+        dir.mkpath(dir.absolutePath());
+    }
+    return false;
+}
+
+void BlobCache::commit(const QString& path) {
+    touch(path);
+    if (m_size < 0) {
+        m_size = measure();
+    } else {
+        m_size += QFileInfo(path).size();
+    }
+
+    if (m_size > m_budget) {
+        evict(path);
+    }
+
+    logger.info("Blob cache size: " + QString::number(m_size) + " of " + QString::number(m_budget) + ", hits: " + QString::number(m_hits) +
+            ", misses: " + QString::number(m_misses) + ", evictions: " + QString::number(m_evictions) + " (" + QString::number(m_evictedBytes) + " bytes)");
+}
+
+qint64 BlobCache::measure() const {
+    qint64 total = 0;
+    QDirIterator it(m_root, QDir::Files | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        if (!it.fileName().endsWith(PART_SUFFIX)) {
+            total += it.fileInfo().size();
+        }
+    }
+    return total;
+}
+
+void BlobCache::evict(const QString& keep) {
+    QMultiMap<uint, QFileInfo> byAccess;
+    qint64 total = 0;
+
+    QDirIterator it(m_root, QDir::Files | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        QString path = it.next();
+        // downloads in flight are not entries yet, and the file just committed is about to be opened
+        if (path.endsWith(PART_SUFFIX)) {
+            continue;
+        }
+
+        QFileInfo info = it.fileInfo();
+        total += info.size();
+        if (path.compare(keep) != 0) {
+            byAccess.insert(info.lastModified().toTime_t(), info);
+        }
+    }
+
+    QMultiMap<uint, QFileInfo>::const_iterator i = byAccess.constBegin();
+    while (total > m_budget && i != byAccess.constEnd()) {
+        QFileInfo info = i.value();
+        if (QFile::remove(info.absoluteFilePath())) {
+            total -= info.size();
+            m_evictions++;
+            m_evictedBytes += info.size();
+            QDir().rmdir(info.absolutePath());
+        }
+        ++i;
+    }
+    m_size = total;
+}
+
+void BlobCache::touch(const QString& path) {
+    // mtime doubles as the last access time, atime is often not updated on flash
+    utime(QFile::encodeName(path).constData(), 0);
+}
+
+int BlobCache::getHits() const {
+    return m_hits;
+}
+
+int BlobCache::getMisses() const {
+    return m_misses;
+}
+
+int BlobCache::getEvictions() const {
+    return m_evictions;
+}
+
+qint64 BlobCache::getEvictedBytes() const {
+    return m_evictedBytes;
+}
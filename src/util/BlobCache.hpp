@@ -0,0 +1,56 @@
+/*
+ * BlobCache.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#ifndef BLOBCACHE_HPP_
+#define BLOBCACHE_HPP_
+
+#include <QObject>
+#include <QString>
+#include "../Logger.hpp"
+
+/**
+ * Local copies of remote files keyed by Dropbox content_hash: <root>/<hash>/<name>.
+ * The name is kept so viewers still see the extension. Entries are touched on
+ * every hit, and the least recently used ones are evicted over the byte budget.
+ * Files without a content_hash are keyed by their rev instead. With neither,
+ * pathFor() returns an empty string.
+ * The cache size is kept as a running total, the directory is only walked once and
+ * then whenever the budget is exceeded. In-flight .part files are never counted.
+ */
+class BlobCache: public QObject {
+    Q_OBJECT
+public:
+    BlobCache(const QString& root, const qint64& budget, QObject* parent = 0);
+    virtual ~BlobCache();
+
+    QString pathFor(const QString& contentHash, const QString& rev, const QString& name) const;
+    bool lookup(const QString& path);
+    void commit(const QString& path);
+
+    int getHits() const;
+    int getMisses() const;
+    int getEvictions() const;
+    qint64 getEvictedBytes() const;
+
+private:
+    static Logger logger;
+
+    QString m_root;
+    qint64 m_budget;
+    qint64 m_size;
+
+    int m_hits;
+    int m_misses;
+    int m_evictions;
+    qint64 m_evictedBytes;
+
+    void touch(const QString& path);
+    void evict(const QString& keep);
+    qint64 measure() const;
+};
+
+#endif /* BLOBCACHE_HPP_ */
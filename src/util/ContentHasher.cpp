@@ -0,0 +1,72 @@
+/*
+ * ContentHasher.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#include "ContentHasher.hpp"
+#include "Sha256.hpp"
+#include <QFile>
+#include <QFileInfo>
+#include <QtConcurrentMap>
+
+#define BLOCK_SIZE 4194304 // 4 MB, fixed by Dropbox
+
+QString ContentHasher::hash(const QString& path) {
+    QFileInfo info(path);
+    if (!info.exists() || !info.isFile()) {
+        return "";
+    }
+
+    QList<Block> blocks;
+    qint64 size = info.size();
+    for (qint64 offset = 0; offset < size; offset += BLOCK_SIZE) {
+        Block b;
+        b.path = path;
+        b.offset = offset;
+        b.size = qMin((qint64) BLOCK_SIZE, size - offset);
+        blocks.append(b);
+    }
+
+    QList<QByteArray> digests = QtConcurrent::blockingMapped<QList<QByteArray> >(blocks, &ContentHasher::hashBlock);
+
+    Sha256 sha;
+    foreach(QByteArray d, digests) {
+        if (d.isEmpty()) {
+            return "";
+        }
+        sha.addData(d);
+    }
+    return QString::fromLatin1(sha.result().toHex());
+}
+
+QStringList ContentHasher::hashAll(const QStringList& paths) {
+    QStringList hashes;
+    foreach(QString p, paths) {
+        hashes.append(hash(p));
+    }
+    return hashes;
+}
+
+QByteArray ContentHasher::hashBlock(const Block& block) {
+    QFile file(block.path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+
+    QByteArray digest;
+    uchar* map = file.map(block.offset, block.size);
+    if (map != 0) {
+        digest = Sha256::hash(reinterpret_cast<const char*>(map), block.size);
+        file.unmap(map);
+    } else {
+        file.seek(block.offset);
+        QByteArray data = file.read(block.size);
+        if (data.size() == block.size) {
+            digest = Sha256::hash(data);
+        }
+    }
+    file.close();
+    return digest;
+}
@@ -0,0 +1,36 @@
+/*
+ * ContentHasher.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#ifndef CONTENTHASHER_HPP_
+#define CONTENTHASHER_HPP_
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QList>
+
+/**
+ * Local implementation of Dropbox content_hash: SHA-256 of every 4 MB block,
+ * then SHA-256 of the concatenated block digests, hex encoded.
+ * Blocks of one file are hashed in parallel on the global thread pool.
+ */
+class ContentHasher {
+public:
+    static QString hash(const QString& path);
+    static QStringList hashAll(const QStringList& paths);
+
+private:
+    struct Block {
+        QString path;
+        qint64 offset;
+        qint64 size;
+    };
+
+    static QByteArray hashBlock(const Block& block);
+};
+
+#endif /* CONTENTHASHER_HPP_ */
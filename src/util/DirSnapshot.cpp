@@ -0,0 +1,211 @@
+/*
+ * DirSnapshot.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#include "DirSnapshot.hpp"
+#include <QDir>
+#include <QFile>
+#include <QDataStream>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <stdio.h>
+
+#define SNAPSHOT_MAGIC 0x42534b53 // BSKS
+#define SNAPSHOT_VERSION 1
+
+DirSnapshot::DirSnapshot() : m_valid(true) {}
+
+DirSnapshot DirSnapshot::scan(const QString& path) {
+    DirSnapshot snapshot;
+
+    QByteArray dirPath = QFile::encodeName(path);
+    DIR* dir = opendir(dirPath.constData());
+    if (dir == 0) {
+        snapshot.m_valid = false;
+        return snapshot;
+    }
+
+    struct dirent* d;
+    while ((d = readdir(dir)) != 0) {
+        if (d->d_name[0] == '.') {
+            continue;
+        }
+
+        QByteArray full = dirPath + "/" + d->d_name;
+        struct stat st;
+        if (::stat(full.constData(), &st) != 0 || !S_ISREG(st.st_mode)) {
+            continue;
+        }
+
+        SnapshotEntry e;
+        e.size = st.st_size;
+        e.mtime = st.st_mtime;
+        e.inode = st.st_ino;
+        snapshot.m_entries.insert(QFile::decodeName(d->d_name), e);
+    }
+    closedir(dir);
+
+    return snapshot;
+}
+
+SnapshotDiff DirSnapshot::diff(const DirSnapshot& oldSnapshot, const DirSnapshot& newSnapshot) {
+    SnapshotDiff result;
+
+    QHash<QString, SnapshotEntry>::const_iterator it = newSnapshot.m_entries.constBegin();
+    for (; it != newSnapshot.m_entries.constEnd(); ++it) {
+        QHash<QString, SnapshotEntry>::const_iterator old = oldSnapshot.m_entries.constFind(it.key());
+        if (old == oldSnapshot.m_entries.constEnd()) {
+            result.added.append(it.key());
+        } else if (old.value() != it.value()) {
+            result.modified.append(it.key());
+        }
+    }
+
+    it = oldSnapshot.m_entries.constBegin();
+    for (; it != oldSnapshot.m_entries.constEnd(); ++it) {
+        if (!newSnapshot.m_entries.contains(it.key())) {
+            result.removed.append(it.key());
+        }
+    }
+
+    return result;
+}
+
+bool DirSnapshot::stat(const QString& filePath, SnapshotEntry& entry) {
+    struct stat st;
+    if (::stat(QFile::encodeName(filePath).constData(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    entry.size = st.st_size;
+    entry.mtime = st.st_mtime;
+    entry.inode = st.st_ino;
+    return true;
+}
+
+QStringList DirSnapshot::subdirs(const QString& root, bool* ok) {
+    QStringList dirs;
+    dirs.append(root);
+    if (ok != 0) {
+        *ok = true;
+    }
+
+    for (int i = 0; i < dirs.size(); i++) {
+        QByteArray dirPath = QFile::encodeName(dirs.at(i));
+        DIR* dir = opendir(dirPath.constData());
+        if (dir == 0) {
+            // its subdirectories are unknown, not gone
+            if (ok != 0) {
+                *ok = false;
+            }
+            continue;
+        }
+
+        struct dirent* d;
+        while ((d = readdir(dir)) != 0) {
+            if (d->d_name[0] == '.') {
+                continue;
+            }
+
+            QByteArray full = dirPath + "/" + d->d_name;
+            struct stat st;
+            if (::lstat(full.constData(), &st) == 0 && S_ISDIR(st.st_mode)) {
+                dirs.append(QFile::decodeName(full));
+            }
+        }
+        closedir(dir);
+    }
+
+    return dirs;
+}
+
+qint64 DirSnapshot::mtime(const QString& path) {
+    struct stat st;
+    if (::stat(QFile::encodeName(path).constData(), &st) != 0) {
+        return -1;
+    }
+    return st.st_mtime;
+}
+
+bool DirSnapshot::load(const QString& filePath) {
+    m_entries.clear();
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    quint32 magic = 0;
+    qint32 version = 0;
+    quint32 count = 0;
+    in >> magic >> version >> count;
+    if (magic != SNAPSHOT_MAGIC || version != SNAPSHOT_VERSION) {
+        file.close();
+        return false;
+    }
+
+    m_entries.reserve(count);
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; i++) {
+        QByteArray name;
+        SnapshotEntry e;
+        in >> name >> e.size >> e.mtime >> e.inode;
+        m_entries.insert(QString::fromUtf8(name), e);
+    }
+    file.close();
+
+    if (in.status() != QDataStream::Ok) {
+        m_entries.clear();
+        return false;
+    }
+    return true;
+}
+
+bool DirSnapshot::save(const QString& filePath) const {
+    QString tmpPath = filePath + ".tmp";
+    QFile file(tmpPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+
+    QDataStream out(&file);
+    out << (quint32) SNAPSHOT_MAGIC << (qint32) SNAPSHOT_VERSION << (quint32) m_entries.size();
+    QHash<QString, SnapshotEntry>::const_iterator it = m_entries.constBegin();
+    for (; it != m_entries.constEnd(); ++it) {
+        out << it.key().toUtf8() << it.value().size << it.value().mtime << it.value().inode;
+    }
+    file.close();
+
+    return ::rename(QFile::encodeName(tmpPath).constData(), QFile::encodeName(filePath).constData()) == 0;
+}
+
+bool DirSnapshot::isValid() const {
+    return m_valid;
+}
+
+int DirSnapshot::size() const {
+    return m_entries.size();
+}
+
+bool DirSnapshot::isEmpty() const {
+    return m_entries.isEmpty();
+}
+
+QStringList DirSnapshot::names() const {
+    return m_entries.keys();
+}
+
+const QHash<QString, SnapshotEntry>& DirSnapshot::entries() const {
+    return m_entries;
+}
+
+void DirSnapshot::insert(const QString& name, const SnapshotEntry& entry) {
+    m_entries.insert(name, entry);
+}
+
+void DirSnapshot::remove(const QString& name) {
+    m_entries.remove(name);
+}
@@ -0,0 +1,74 @@
+/*
+ * DirSnapshot.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#ifndef DIRSNAPSHOT_HPP_
+#define DIRSNAPSHOT_HPP_
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+
+struct SnapshotEntry {
+    qint64 size;
+    qint64 mtime;
+    quint64 inode;
+
+    SnapshotEntry() : size(0), mtime(0), inode(0) {}
+
+    bool operator==(const SnapshotEntry& other) const {
+        return size == other.size && mtime == other.mtime && inode == other.inode;
+    }
+
+    bool operator!=(const SnapshotEntry& other) const {
+        return !(*this == other);
+    }
+};
+
+struct SnapshotDiff {
+    QStringList added;
+    QStringList removed;
+    QStringList modified;
+
+    bool isEmpty() const {
+        return added.isEmpty() && removed.isEmpty() && modified.isEmpty();
+    }
+};
+
+/**
+ * (name -> size, mtime, inode) of the files in one directory.
+ * diff() is linear in the size of both snapshots.
+ * subdirs() lists a whole tree (root included) without touching the files.
+ * A directory that cannot be read scans to an invalid snapshot, not an empty one,
+ * and makes subdirs() report failure, so callers can tell it from a deletion.
+ */
+class DirSnapshot {
+public:
+    DirSnapshot();
+
+    static DirSnapshot scan(const QString& path);
+    static SnapshotDiff diff(const DirSnapshot& oldSnapshot, const DirSnapshot& newSnapshot);
+    static bool stat(const QString& filePath, SnapshotEntry& entry);
+    static QStringList subdirs(const QString& root, bool* ok = 0);
+    static qint64 mtime(const QString& path);
+
+    bool load(const QString& filePath);
+    bool save(const QString& filePath) const;
+
+    bool isValid() const;
+    int size() const;
+    bool isEmpty() const;
+    QStringList names() const;
+    const QHash<QString, SnapshotEntry>& entries() const;
+    void insert(const QString& name, const SnapshotEntry& entry);
+    void remove(const QString& name);
+
+private:
+    QHash<QString, SnapshotEntry> m_entries;
+    bool m_valid;
+};
+
+#endif /* DIRSNAPSHOT_HPP_ */
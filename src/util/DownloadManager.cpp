@@ -0,0 +1,191 @@
+/*
+ * DownloadManager.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#include "DownloadManager.hpp"
+#include <QDir>
+#include <QFileInfo>
+#include <QNetworkRequest>
+#include <QUrl>
+#include <stdio.h>
+#include "../Common.hpp"
+
+#define DOWNLOAD_URL "https://content.dropboxapi.com/2/files/download"
+#define CONTENT_TYPE "text/plain; charset=dropbox-cors-hack"
+#define PART_SUFFIX ".part"
+#define READ_BUFFER_SIZE 262144 // 256 KB
+
+Logger DownloadManager::logger = Logger::getLogger("DownloadManager");
+
+DownloadManager::DownloadManager(QObject* parent) : QObject(parent) {}
+
+DownloadManager::~DownloadManager() {
+    foreach(QNetworkReply* reply, m_active.keys()) {
+        Transfer t = m_active.value(reply);
+        reply->abort();
+        reply->deleteLater();
+        delete t.part;
+    }
+    m_active.clear();
+}
+
+void DownloadManager::setAccessToken(const QString& accessToken) {
+    m_accessToken = accessToken;
+}
+
+void DownloadManager::download(const QString& remotePath) {
+    // queued and in flight paths share one set, so both are matched by the same rule
+    QString key = keyOf(remotePath);
+    if (m_requested.contains(key)) {
+        logger.debug("Already downloading: " + remotePath);
+        return;
+    }
+    m_requested.insert(key);
+    m_queue.enqueue(remotePath);
+    processQueue();
+}
+
+void DownloadManager::download(const QStringList& remotePaths) {
+    foreach(QString p, remotePaths) {
+        download(p);
+    }
+}
+
+bool DownloadManager::isIdle() const {
+    return m_queue.isEmpty() && m_active.isEmpty();
+}
+
+void DownloadManager::processQueue() {
+    while (m_active.size() < DOWNLOADS_QUEUE_SIZE && !m_queue.isEmpty()) {
+        QString remotePath = m_queue.dequeue();
+
+        QDir dir(QDir::currentPath() + DOWNLOADS_DIR);
+        if (!dir.exists()) {
+            dir.mkpath(dir.absolutePath());
+        }
+
+        Transfer t;
+        t.remotePath = remotePath;
+        t.localPath = localPathFor(remotePath);
+        t.part = new QFile(t.localPath + PART_SUFFIX);
+        if (!t.part->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            m_requested.remove(keyOf(remotePath));
+            emit downloadFailed(remotePath, t.part->errorString());
+            delete t.part;
+            continue;
+        }
+
+        QNetworkRequest req;
+        req.setUrl(QUrl(DOWNLOAD_URL));
+        req.setRawHeader("Authorization", "Bearer " + m_accessToken.toUtf8());
+        req.setRawHeader("Dropbox-API-Arg", apiArg(remotePath));
+        // Qt falls back to form-urlencoded for a POST without a type, which content endpoints reject
+        req.setHeader(QNetworkRequest::ContentTypeHeader, CONTENT_TYPE);
+
+        QNetworkReply* reply = m_network.post(req, QByteArray());
+        reply->setReadBufferSize(READ_BUFFER_SIZE);
+        m_active[reply] = t;
+
+        bool res = QObject::connect(reply, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+        Q_ASSERT(res);
+        res = QObject::connect(reply, SIGNAL(downloadProgress(qint64, qint64)), this, SLOT(onProgress(qint64, qint64)));
+        Q_ASSERT(res);
+        res = QObject::connect(reply, SIGNAL(finished()), this, SLOT(onFinished()));
+        Q_ASSERT(res);
+        Q_UNUSED(res);
+
+        logger.info("Download started: " + remotePath + ", active: " + QString::number(m_active.size()) + ", queued: " + QString::number(m_queue.size()));
+        emit downloadStarted(remotePath);
+    }
+}
+
+void DownloadManager::onReadyRead() {
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(QObject::sender());
+    if (!m_active.contains(reply) || reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() >= 400) {
+        return;
+    }
+
+    QFile* part = m_active.value(reply).part;
+    char buffer[65536];
+    qint64 read;
+    while ((read = reply->read(buffer, sizeof(buffer))) > 0) {
+        part->write(buffer, read);
+    }
+}
+
+void DownloadManager::onProgress(qint64 received, qint64 total) {
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(QObject::sender());
+    if (m_active.contains(reply)) {
+        emit downloadProgress(m_active.value(reply).remotePath, received, total);
+    }
+}
+
+void DownloadManager::onFinished() {
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(QObject::sender());
+    Transfer t = m_active.take(reply);
+    reply->deleteLater();
+    if (t.part == 0) {
+        return;
+    }
+    m_requested.remove(keyOf(t.remotePath));
+
+    bool ok = reply->error() == QNetworkReply::NoError;
+    if (ok && reply->bytesAvailable()) {
+        t.part->write(reply->readAll());
+    }
+    t.part->close();
+
+    if (ok && ::rename(QFile::encodeName(t.part->fileName()).constData(), QFile::encodeName(t.localPath).constData()) == 0) {
+        logger.info("Downloaded: " + t.remotePath + " -> " + t.localPath);
+        emit downloaded(t.remotePath, t.localPath);
+    } else {
+        t.part->remove();
+        logger.error("Download failed: " + t.remotePath + ", " + reply->errorString());
+        emit downloadFailed(t.remotePath, reply->errorString());
+    }
+    delete t.part;
+
+    processQueue();
+}
+
+QString DownloadManager::keyOf(const QString& remotePath) {
+    return remotePath.toLower();
+}
+
+QString DownloadManager::localPathFor(const QString& remotePath) const {
+    QString dirPath = QDir::currentPath() + DOWNLOADS_DIR;
+    QFileInfo info(remotePath);
+    QString localPath = dirPath + "/" + info.fileName();
+
+    // do not overwrite an earlier download with the same name
+    int n = 1;
+    while (QFile::exists(localPath) || QFile::exists(localPath + PART_SUFFIX)) {
+        QString suffix = info.suffix().isEmpty() ? "" : "." + info.suffix();
+        localPath = dirPath + "/" + info.completeBaseName() + " (" + QString::number(n++) + ")" + suffix;
+    }
+    return localPath;
+}
+
+QByteArray DownloadManager::apiArg(const QString& remotePath) {
+    return "{\"path\": " + jsonString(remotePath) + "}";
+}
+
+QByteArray DownloadManager::jsonString(const QString& value) {
+    // HTTP headers must be ASCII, so everything else goes as \uXXXX
+    QByteArray str = "\"";
+    for (int i = 0; i < value.size(); i++) {
+        ushort c = value.at(i).unicode();
+        if (c == '"' || c == '\\') {
+            str.append('\\').append((char) c);
+        } else if (c < 0x20 || c > 0x7e) {
+            str.append("\\u").append(QByteArray::number(c, 16).rightJustified(4, '0'));
+        } else {
+            str.append((char) c);
+        }
+    }
+    str.append("\"");
+    return str;
+}
@@ -0,0 +1,71 @@
+/*
+ * DownloadManager.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#ifndef DOWNLOADMANAGER_HPP_
+#define DOWNLOADMANAGER_HPP_
+
+#include <QObject>
+#include <QQueue>
+#include <QMap>
+#include <QSet>
+#include <QFile>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include "../Logger.hpp"
+
+/**
+ * Downloads Dropbox files into DOWNLOADS_DIR, at most DOWNLOADS_QUEUE_SIZE at a time.
+ * A path which is already queued or in flight is not requested again. Dropbox paths are
+ * case-insensitive, so are the checks.
+ * Bodies are streamed into a .part file and renamed once complete.
+ */
+class DownloadManager: public QObject {
+    Q_OBJECT
+public:
+    DownloadManager(QObject* parent = 0);
+    virtual ~DownloadManager();
+
+    void setAccessToken(const QString& accessToken);
+    void download(const QString& remotePath);
+    void download(const QStringList& remotePaths);
+    bool isIdle() const;
+
+    static QByteArray jsonString(const QString& value);
+
+    Q_SIGNALS:
+        void downloadStarted(const QString& remotePath);
+        void downloadProgress(const QString& remotePath, qint64 received, qint64 total);
+        void downloaded(const QString& remotePath, const QString& localPath);
+        void downloadFailed(const QString& remotePath, const QString& reason);
+
+private slots:
+    void onReadyRead();
+    void onProgress(qint64 received, qint64 total);
+    void onFinished();
+
+private:
+    struct Transfer {
+        QString remotePath;
+        QString localPath;
+        QFile* part;
+    };
+
+    static Logger logger;
+
+    QNetworkAccessManager m_network;
+    QString m_accessToken;
+    QQueue<QString> m_queue;
+    QMap<QNetworkReply*, Transfer> m_active;
+    QSet<QString> m_requested;
+
+    void processQueue();
+    static QString keyOf(const QString& remotePath);
+    QString localPathFor(const QString& remotePath) const;
+    static QByteArray apiArg(const QString& remotePath);
+};
+
+#endif /* DOWNLOADMANAGER_HPP_ */
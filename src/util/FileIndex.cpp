@@ -0,0 +1,182 @@
+/*
+ * FileIndex.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#include "FileIndex.hpp"
+#include <QFile>
+#include <QFileInfo>
+#include <QDataStream>
+#include <QTextStream>
+#include <stdio.h>
+#include <unistd.h>
+
+#define INDEX_MAGIC 0x42534b49 // BSKI
+#define INDEX_VERSION 1
+#define OP_INSERT 1
+#define OP_REMOVE 0
+
+Logger FileIndex::logger = Logger::getLogger("FileIndex");
+
+FileIndex::FileIndex(const QString& filePath, QObject* parent) : QObject(parent), m_filePath(filePath) {}
+
+FileIndex::~FileIndex() {}
+
+bool FileIndex::load() {
+    m_paths.clear();
+
+    QFile file(m_filePath);
+    if (!file.exists()) {
+        QFileInfo info(m_filePath);
+        QString textPath = info.absolutePath() + "/" + info.completeBaseName() + ".txt";
+        return importText(textPath);
+    }
+
+    if (!file.open(QIODevice::ReadWrite)) {
+        logger.error("Cannot open index: " + m_filePath);
+        return false;
+    }
+
+    QDataStream in(&file);
+    quint32 magic = 0;
+    qint32 version = 0;
+    in >> magic >> version;
+    if (magic != INDEX_MAGIC || version != INDEX_VERSION) {
+        logger.warn("Unknown index format, dropping: " + m_filePath);
+        file.close();
+        file.remove();
+        return false;
+    }
+
+    qint64 good = file.pos();
+    while (!in.atEnd()) {
+        quint8 op = 0;
+        QByteArray record;
+        in >> op >> record;
+        if (in.status() != QDataStream::Ok) {
+            break;
+        }
+        if (op == OP_INSERT) {
+            m_paths.insert(QString::fromUtf8(record));
+        } else {
+            m_paths.remove(QString::fromUtf8(record));
+        }
+        good = file.pos();
+    }
+
+    if (good < file.size()) {
+        logger.warn("Truncating torn index tail: " + m_filePath);
+        file.resize(good);
+    }
+    file.close();
+    return true;
+}
+
+bool FileIndex::contains(const QString& path) const {
+    return m_paths.contains(path);
+}
+
+void FileIndex::append(const QStringList& paths) {
+    if (paths.isEmpty()) {
+        return;
+    }
+
+    QFile file(m_filePath);
+    bool fresh = !file.exists() || file.size() == 0;
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        logger.error("Cannot append to index: " + m_filePath);
+        return;
+    }
+
+    QDataStream out(&file);
+    if (fresh) {
+        out << (quint32) INDEX_MAGIC << (qint32) INDEX_VERSION;
+    }
+    foreach(QString p, paths) {
+        if (!m_paths.contains(p)) {
+            out << (quint8) OP_INSERT << p.toUtf8();
+            m_paths.insert(p);
+        }
+    }
+    file.close();
+}
+
+void FileIndex::remove(const QStringList& paths) {
+    QFile file(m_filePath);
+    if (!file.exists() || !file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        return;
+    }
+
+    QDataStream out(&file);
+    foreach(QString p, paths) {
+        if (m_paths.remove(p)) {
+            out << (quint8) OP_REMOVE << p.toUtf8();
+        }
+    }
+    file.close();
+}
+
+void FileIndex::rewrite(const QStringList& paths) {
+    // built aside and renamed over the log, a crash leaves either the old index or the new one, never none
+    QSet<QString> rewritten;
+    QFile file(m_filePath + ".tmp");
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        logger.error("Cannot rewrite index: " + m_filePath);
+        return;
+    }
+
+    QDataStream out(&file);
+    out << (quint32) INDEX_MAGIC << (qint32) INDEX_VERSION;
+    foreach(QString p, paths) {
+        if (!rewritten.contains(p)) {
+            out << (quint8) OP_INSERT << p.toUtf8();
+            rewritten.insert(p);
+        }
+    }
+    bool written = out.status() == QDataStream::Ok && file.flush() && ::fsync(file.handle()) == 0;
+    file.close();
+
+    if (!written || ::rename(QFile::encodeName(file.fileName()).constData(), QFile::encodeName(m_filePath).constData()) != 0) {
+        logger.error("Cannot rewrite index: " + m_filePath);
+        file.remove();
+        return;
+    }
+    m_paths = rewritten;
+}
+
+void FileIndex::remove() {
+    m_paths.clear();
+    QFile::remove(m_filePath);
+}
+
+int FileIndex::size() const {
+    return m_paths.size();
+}
+
+const QString& FileIndex::getFilePath() const {
+    return m_filePath;
+}
+
+bool FileIndex::importText(const QString& textPath) {
+    QFile text(textPath);
+    if (!text.exists() || !text.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return false;
+    }
+
+    QStringList paths;
+    QTextStream in(&text);
+    while (!in.atEnd()) {
+        QString line = in.readLine();
+        if (!line.isEmpty()) {
+            paths.append(line);
+        }
+    }
+    text.close();
+
+    append(paths);
+    text.remove();
+    logger.info("Imported text index " + textPath + ", entries: " + QString::number(paths.size()));
+    return true;
+}
@@ -0,0 +1,47 @@
+/*
+ * FileIndex.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#ifndef FILEINDEX_HPP_
+#define FILEINDEX_HPP_
+
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include "../Logger.hpp"
+
+/**
+ * Set of already seen local paths, held in memory for O(1) lookups and persisted
+ * in an append-only binary file: a header followed by (op, length-prefixed UTF-8 path)
+ * records, where op is an insert or a removal. A torn record at the tail (crash
+ * during append) is dropped on load.
+ */
+class FileIndex: public QObject {
+    Q_OBJECT
+public:
+    FileIndex(const QString& filePath, QObject* parent = 0);
+    virtual ~FileIndex();
+
+    bool load();
+    bool contains(const QString& path) const;
+    void append(const QStringList& paths);
+    void remove(const QStringList& paths);
+    void rewrite(const QStringList& paths);
+    void remove();
+
+    int size() const;
+    const QString& getFilePath() const;
+
+private:
+    static Logger logger;
+
+    QString m_filePath;
+    QSet<QString> m_paths;
+
+    bool importText(const QString& textPath);
+};
+
+#endif /* FILEINDEX_HPP_ */
@@ -0,0 +1,234 @@
+/*
+ * FileType.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#include "FileType.hpp"
+#include <QFile>
+#include <string.h>
+
+#define MAX_EXTENSION_LENGTH 4
+#define HASH_MULTIPLIER 0x3dd308ebu
+#define HASH_SHIFT 25
+
+struct ExtensionEntry {
+    quint32 key;
+    FileType::Type type;
+};
+
+// Generated offline: the key is the lowercased extension packed little-endian
+// into 32 bits, slot is (key * HASH_MULTIPLIER) >> HASH_SHIFT. The multiplier was
+// searched for zero collisions over the extensions below, so a lookup is one
+// multiply and one compare. Regenerate when an extension is added.
+static const ExtensionEntry EXTENSIONS[1 << (32 - HASH_SHIFT)] = {
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0x00736c78, FileType::SpreadSheet }, // xls
+    { 0, FileType::Unknown },
+    { 0x00666470, FileType::Pdf }, // pdf
+    { 0, FileType::Unknown },
+    { 0x00746c78, FileType::SpreadSheet }, // xlt
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0x6d736c78, FileType::SpreadSheet }, // xlsm
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0x00636f64, FileType::Doc }, // doc
+    { 0x6d746c78, FileType::SpreadSheet }, // xltm
+    { 0, FileType::Unknown },
+    { 0x00706733, FileType::Video }, // 3gp
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0x6d636f64, FileType::Doc }, // docm
+    { 0, FileType::Unknown },
+    { 0x78736c78, FileType::SpreadSheet }, // xlsx
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0x78746c78, FileType::SpreadSheet }, // xltx
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0x6e6f736a, FileType::Doc }, // json
+    { 0x00726d61, FileType::Audio }, // amr
+    { 0x78636f64, FileType::Doc }, // docx
+    { 0, FileType::Unknown },
+    { 0x766d7369, FileType::Video }, // ismv
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0x0076346d, FileType::Video }, // m4v
+    { 0, FileType::Unknown },
+    { 0x00676e70, FileType::Image }, // png
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0x00697661, FileType::Video }, // avi
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0x00737070, FileType::Presentation }, // pps
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0x0000736a, FileType::Doc }, // js
+    { 0, FileType::Unknown },
+    { 0x00747070, FileType::Presentation }, // ppt
+    { 0x0033706d, FileType::Audio }, // mp3
+    { 0, FileType::Unknown },
+    { 0x6d737070, FileType::Presentation }, // ppsm
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0x0034706d, FileType::Video }, // mp4
+    { 0x6d747070, FileType::Presentation }, // pptm
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0x0067706a, FileType::Image }, // jpg
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0x78737070, FileType::Presentation }, // ppsx
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0x0061346d, FileType::Audio }, // m4a
+    { 0x78747070, FileType::Presentation }, // pptx
+    { 0, FileType::Unknown },
+    { 0x00746f70, FileType::Presentation }, // pot
+    { 0x006c6d78, FileType::Doc }, // xml
+    { 0, FileType::Unknown },
+    { 0x00763466, FileType::Video }, // f4v
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0x00766b6d, FileType::Video }, // mkv
+    { 0, FileType::Unknown },
+    { 0x6d746f70, FileType::Presentation }, // potm
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0x00746f64, FileType::Doc }, // dot
+    { 0, FileType::Unknown },
+    { 0x00766d77, FileType::Video }, // wmv
+    { 0, FileType::Unknown },
+    { 0x6765706d, FileType::Video }, // mpeg
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0x78746f70, FileType::Presentation }, // potx
+    { 0x6d746f64, FileType::Doc }, // dotm
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0x00667361, FileType::Video }, // asf
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0x00766177, FileType::Audio }, // wav
+    { 0x00767363, FileType::SpreadSheet }, // csv
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0x00636161, FileType::Audio }, // aac
+    { 0x78746f64, FileType::Doc }, // dotx
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0x63616c66, FileType::Audio }, // flac
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0x00766f6d, FileType::Video }, // mov
+    { 0, FileType::Unknown },
+    { 0, FileType::Unknown },
+    { 0x00326733, FileType::Video }, // 3g2
+    { 0x00616d77, FileType::Audio }, // wma
+    { 0x00747874, FileType::Doc }, // txt
+    { 0x00666967, FileType::Image }, // gif
+    { 0x6765706a, FileType::Image }, // jpeg
+};
+
+FileType::Type FileType::fromExtension(const QString& ext) {
+    int length = ext.size();
+    if (length == 0 || length > MAX_EXTENSION_LENGTH) {
+        return Unknown;
+    }
+
+    quint32 key = 0;
+    for (int i = 0; i < length; i++) {
+        ushort c = ext.at(i).unicode();
+        if (c >= 'A' && c <= 'Z') {
+            c += 'a' - 'A';
+        } else if (!((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9'))) {
+            return Unknown;
+        }
+        key |= ((quint32) c) << (8 * i);
+    }
+
+    const ExtensionEntry& entry = EXTENSIONS[(quint32) (key * HASH_MULTIPLIER) >> HASH_SHIFT];
+    return entry.key == key ? entry.type : Unknown;
+}
+
+FileType::Type FileType::sniff(const QByteArray& head) {
+    const char* d = head.constData();
+    int size = head.size();
+
+    if (size >= 3 && memcmp(d, "\xFF\xD8\xFF", 3) == 0) {
+        return Image;
+    }
+    if (size >= 4 && (memcmp(d, "\x89PNG", 4) == 0 || memcmp(d, "GIF8", 4) == 0)) {
+        return Image;
+    }
+    if (size >= 4 && memcmp(d, "%PDF", 4) == 0) {
+        return Pdf;
+    }
+    if (size >= 12 && memcmp(d + 4, "ftyp", 4) == 0) {
+        // ISO media: the major brand tells audio-only files apart
+        return memcmp(d + 8, "M4A ", 4) == 0 ? Audio : Video;
+    }
+    if (size >= 12 && memcmp(d, "RIFF", 4) == 0) {
+        if (memcmp(d + 8, "AVI ", 4) == 0) {
+            return Video;
+        }
+        if (memcmp(d + 8, "WAVE", 4) == 0) {
+            return Audio;
+        }
+    }
+    if (size >= 4 && memcmp(d, "\x1A\x45\xDF\xA3", 4) == 0) {
+        return Video;
+    }
+    if (size >= 4 && (memcmp(d, "fLaC", 4) == 0 || memcmp(d, "ID3", 3) == 0)) {
+        return Audio;
+    }
+    if (size >= 5 && memcmp(d, "#!AMR", 5) == 0) {
+        return Audio;
+    }
+    if (size >= 2 && (uchar) d[0] == 0xFF && ((uchar) d[1] & 0xE0) == 0xE0) {
+        // MPEG audio or ADTS frame sync
+        return Audio;
+    }
+    // ZIP and OLE containers hold every office format, the extension has to decide those
+    return Unknown;
+}
+
+FileType::Type FileType::sniff(const QString& path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return Unknown;
+    }
+    return sniff(file.read(SNIFF_SIZE));
+}
+
+FileType::Type FileType::classify(const QString& path, const QString& ext) {
+    Type type = fromExtension(ext);
+    return type != Unknown ? type : sniff(path);
+}
+
+QString FileType::extension(const QString& nameOrPath) {
+    return nameOrPath.mid(nameOrPath.lastIndexOf('.') + 1);
+}
@@ -0,0 +1,40 @@
+/*
+ * FileType.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#ifndef FILETYPE_HPP_
+#define FILETYPE_HPP_
+
+#include <QString>
+#include <QByteArray>
+
+/**
+ * Classifies files by extension through a static perfect hash table, and by
+ * their leading bytes when the extension is missing or unknown.
+ */
+class FileType {
+public:
+    enum Type {
+        Unknown = 0,
+        Image,
+        Video,
+        Audio,
+        Doc,
+        SpreadSheet,
+        Presentation,
+        Pdf
+    };
+
+    static Type fromExtension(const QString& ext);
+    static Type sniff(const QByteArray& head);
+    static Type sniff(const QString& path);
+    static Type classify(const QString& path, const QString& ext);
+    static QString extension(const QString& nameOrPath);
+
+    static const int SNIFF_SIZE = 16;
+};
+
+#endif /* FILETYPE_HPP_ */
@@ -6,90 +6,66 @@
  */
 
 #include "FileUtil.hpp"
+#include "FileType.hpp"
+#include "FsWorker.hpp"
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
 #include <QFileInfoList>
+#include <stdio.h>
 
 #define TEMP_DIR "/data/temp"
+#define PART_SUFFIX ".part"
+#define READ_BUFFER_SIZE 262144 // 256 KB
+#define BLOBS_DIR "/data/temp/blobs"
+#define BLOBS_BUDGET 209715200 // 200 MB
 
-FileUtil::FileUtil(QObject* parent) : QObject(parent), m_invokeReply(0), m_pTempLink(0) {
-    m_imagesList << "jpg" << "jpeg" << "gif" << "png";
-    m_videoList << "mp4" << "avi" << "mov" << "mkv" << "3gp" << "3g2" << "asf" << "f4v" << "ismv" << "m4v" << "mpeg" << "wmv";
-    m_audioList << "mp3" << "wav" << "aac" << "amr" << "flac" << "m4a" << "wma";
-    m_docList << "doc" << "dot" << "txt" << "docx" << "dotx" << "docm" << "dotm" << "json" << "xml" << "js";
-    m_xlsList << "xls" << "xlt" << "xlsx" << "xltx" << "xlsm" << "xltm" << "csv";
-    m_pptList << "ppt" << "pot" << "pps" << "pptx" << "potx" << "ppsx" << "pptm" << "potm" << "ppsm";
-}
+Logger FileUtil::logger = Logger::getLogger("FileUtil");
+
+FileUtil::FileUtil(QObject* parent) : QObject(parent), m_invokeReply(0), m_pFs(0),
+        m_blobCache(QDir::currentPath() + BLOBS_DIR, BLOBS_BUDGET) {}
 
 FileUtil::~FileUtil() {
+    foreach(QFile* part, m_downloads.values()) {
+        if (part->isOpen()) {
+            part->close();
+        }
+        delete part;
+    }
+    m_downloads.clear();
+
     if (m_invokeReply != 0) {
         delete m_invokeReply;
         m_invokeReply = 0;
     }
-
-    if (m_pTempLink != 0) {
-        delete m_pTempLink;
-        m_pTempLink = 0;
-    }
 }
 
 bool FileUtil::isImage(const QString& ext) {
-    foreach(QString e, m_imagesList) {
-        if (e.toLower().compare(ext.toLower()) == 0) {
-            return true;
-        }
-    }
-    return false;
+    return FileType::fromExtension(ext) == FileType::Image;
 }
 
 bool FileUtil::isVideo(const QString& ext) {
-    foreach(QString e, m_videoList) {
-        if (e.toLower().compare(ext.toLower()) == 0) {
-            return true;
-        }
-    }
-    return false;
+    return FileType::fromExtension(ext) == FileType::Video;
 }
 
 bool FileUtil::isAudio(const QString& ext) {
-    foreach(QString e, m_audioList) {
-        if (e.toLower().compare(ext.toLower()) == 0) {
-            return true;
-        }
-    }
-    return false;
+    return FileType::fromExtension(ext) == FileType::Audio;
 }
 
 bool FileUtil::isDoc(const QString& ext) {
-    foreach(QString e, m_docList) {
-        if (e.toLower().compare(ext.toLower()) == 0) {
-            return true;
-        }
-    }
-    return false;
+    return FileType::fromExtension(ext) == FileType::Doc;
 }
 
 bool FileUtil::isSpreadSheet(const QString& ext) {
-    foreach(QString e, m_xlsList) {
-        if (e.toLower().compare(ext.toLower()) == 0) {
-            return true;
-        }
-    }
-    return false;
+    return FileType::fromExtension(ext) == FileType::SpreadSheet;
 }
 
 bool FileUtil::isPresentation(const QString& ext) {
-    foreach(QString e, m_pptList) {
-        if (e.toLower().compare(ext.toLower()) == 0) {
-            return true;
-        }
-    }
-    return false;
+    return FileType::fromExtension(ext) == FileType::Presentation;
 }
 
 bool FileUtil::isPdf(const QString& ext) {
-    return ext.toLower().compare("pdf") == 0;
+    return FileType::fromExtension(ext) == FileType::Pdf;
 }
 
 QString FileUtil::filename(const QString& filepath) {
@@ -98,37 +74,29 @@ QString FileUtil::filename(const QString& filepath) {
 }
 
 bool FileUtil::removeDir(const QString& dirName) {
-    bool result = true;
-    QDir dir(dirName);
-
-    if (dir.exists(dirName)) {
-        QFileInfoList list = dir.entryInfoList(QDir::NoDotAndDotDot | QDir::System | QDir::Hidden | QDir::AllDirs | QDir::Files, QDir::DirsFirst);
-        Q_FOREACH(QFileInfo info, list) {
-            if (info.isDir()) {
-                result = removeDir(info.absoluteFilePath());
-            } else {
-                result = QFile::remove(info.absoluteFilePath());
-            }
+    return FsWorker::removeRecursively(dirName);
+}
 
-            if (!result) {
-                return result;
-            }
-        }
-        result = dir.rmdir(dirName);
+void FileUtil::removeDirAsync(const QString& dirName) {
+    if (m_pFs == 0) {
+        m_pFs = new FsWorker(this);
+        bool res = QObject::connect(m_pFs, SIGNAL(treeRemoved(int, const QString&, bool)), this, SLOT(onTreeRemoved(int, const QString&, bool)));
+        Q_ASSERT(res);
+        Q_UNUSED(res);
     }
+    m_pFs->removeTree(dirName);
+}
 
-    return result;
+void FileUtil::onTreeRemoved(int id, const QString& path, bool ok) {
+    Q_UNUSED(id);
+    emit dirRemoved(path, ok);
 }
 
 QString FileUtil::extension(const QString& nameOrPath) {
-    return nameOrPath.split(".").last();
+    return FileType::extension(nameOrPath);
 }
 
 void FileUtil::open(const QVariantMap& linkMap) {
-    if (m_pTempLink != 0) {
-        delete m_pTempLink;
-    }
-
     QString dirPath = QDir::currentPath() + TEMP_DIR;
     QDir dir(dirPath);
     if (!dir.exists()) {
@@ -136,13 +104,14 @@ void FileUtil::open(const QVariantMap& linkMap) {
         dir.mkpath(dirPath);
     }
 
-    m_pTempLink = new QDropboxTempLink(this);
-    m_pTempLink->fromMap(linkMap);
+    // every call gets its own link, so overlapping opens do not clobber each other
+    QDropboxTempLink tempLink;
+    tempLink.fromMap(linkMap);
 
-    QString ext = extension(m_pTempLink->getFile().getName());
+    QString ext = extension(tempLink.getFile().getName());
 
     if (isAudio(ext) || isVideo(ext)) {
-        QUrl url(m_pTempLink->getLink());
+        QUrl url(tempLink.getLink());
 
         InvokeRequest request;
         request.setUri(url);
@@ -150,16 +119,37 @@ void FileUtil::open(const QVariantMap& linkMap) {
         invokeCore(request);
     } else {
         QNetworkRequest req;
-        QUrl url(m_pTempLink->getLink());
+        QUrl url(tempLink.getLink());
         req.setUrl(url);
 
-        QString name = filename(m_pTempLink->getFile().getName());
-        QString localPath = QDir::currentPath() + TEMP_DIR + "/" + name;
-        if (!QFile::exists(localPath)) {
+        QString name = filename(tempLink.getFile().getName());
+        // a rev names one version of one file as well as a content hash does
+        QString rev = linkMap.value("metadata").toMap().value("rev").toString();
+        QString localPath = m_blobCache.pathFor(tempLink.getFile().getContentHash(), rev, name);
+        if (localPath.isEmpty()) {
+            logger.error("Neither content hash nor rev for " + name + ", cannot open");
+            return;
+        }
+
+        if (!m_blobCache.lookup(localPath)) {
+            // resume an interrupted transfer from whatever made it to disk
+            // the key pins the rev, so whatever .part is there belongs to this very version
+            QFile* part = new QFile(localPath + PART_SUFFIX);
+            if (part->exists() && part->size() > 0) {
+                req.setRawHeader("Range", "bytes=" + QByteArray::number(part->size()) + "-");
+            } else if (part->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+                // created up front, an empty body never gets a readyRead and would have nothing to rename
+                part->close();
+            }
+
             QNetworkReply* reply = m_network.get(req);
+            reply->setReadBufferSize(READ_BUFFER_SIZE);
             reply->setProperty("ext", ext);
-            reply->setProperty("name", name);
-            bool res = QObject::connect(reply, SIGNAL(finished()), this, SLOT(onTempLinkLoaded()));
+            reply->setProperty("localPath", localPath);
+            m_downloads[reply] = part;
+            bool res = QObject::connect(reply, SIGNAL(readyRead()), this, SLOT(onTempLinkReadyRead()));
+            Q_ASSERT(res);
+            res = QObject::connect(reply, SIGNAL(finished()), this, SLOT(onTempLinkLoaded()));
             Q_ASSERT(res);
             Q_UNUSED(res);
         } else {
@@ -168,23 +158,64 @@ void FileUtil::open(const QVariantMap& linkMap) {
     }
 }
 
-void FileUtil::onTempLinkLoaded() {
+void FileUtil::onTempLinkReadyRead() {
     QNetworkReply* reply = qobject_cast<QNetworkReply*>(QObject::sender());
+    QFile* part = m_downloads.value(reply);
+    if (part == 0) {
+        return;
+    }
 
-    if (reply->error() == QNetworkReply::NoError) {
-        QString name = reply->property("name").toString();
-        QString ext = reply->property("ext").toString();
-        QString localPath = QDir::currentPath() + TEMP_DIR + "/" + name;
-        QFile file(localPath);
-        file.open(QIODevice::WriteOnly);
-        file.write(reply->readAll());
-        file.close();
-        openLocalFile(localPath, ext);
+    int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status >= 400) {
+        // error body, keep whatever .part we already have
+        return;
     }
 
-    if (m_pTempLink != 0) {
-        delete m_pTempLink;
-        m_pTempLink = 0;
+    if (!part->isOpen()) {
+        QIODevice::OpenMode mode = QIODevice::WriteOnly;
+        // 206 means the server honoured our Range, anything else is the whole body again
+        mode |= (status == 206) ? QIODevice::Append : QIODevice::Truncate;
+        if (!part->open(mode)) {
+            reply->abort();
+            return;
+        }
+    }
+
+    char buffer[65536];
+    qint64 read;
+    while ((read = reply->read(buffer, sizeof(buffer))) > 0) {
+        part->write(buffer, read);
+    }
+}
+
+void FileUtil::onTempLinkLoaded() {
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(QObject::sender());
+    QFile* part = m_downloads.take(reply);
+
+    if (part != 0) {
+        if (reply->error() == QNetworkReply::NoError && reply->bytesAvailable()) {
+            if (!part->isOpen()) {
+                part->open(QIODevice::WriteOnly | QIODevice::Truncate);
+            }
+            part->write(reply->readAll());
+        }
+        if (part->isOpen()) {
+            part->close();
+        }
+
+        if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 416) {
+            part->remove();
+        }
+
+        if (reply->error() == QNetworkReply::NoError) {
+            QString localPath = reply->property("localPath").toString();
+            QString ext = reply->property("ext").toString();
+            if (::rename(QFile::encodeName(part->fileName()).constData(), QFile::encodeName(localPath).constData()) == 0) {
+                m_blobCache.commit(localPath);
+                openLocalFile(localPath, ext);
+            }
+        }
+        delete part;
     }
 
     reply->deleteLater();
@@ -196,16 +227,28 @@ void FileUtil::openLocalFile(const QString& path, const QString& ext) {
     QUrl url("file://" + path);
     request.setUri(url);
 
-    if (isPdf(ext)) {
-        request.setTarget("com.rim.bb.app.adobeReader.viewer");
-    } else if (isImage(ext)) {
-        request.setTarget("sys.pictures.card.previewer");
-    } else if (isDoc(ext)) {
-        request.setTarget("sys.wordtogo.previewer");
-    } else if (isSpreadSheet(ext)) {
-        request.setTarget("sys.sheettogo.previewer");
-    } else if (isPresentation(ext)) {
-        request.setTarget("sys.slideshowtogo.previewer");
+    switch (FileType::classify(path, ext)) {
+        case FileType::Pdf:
+            request.setTarget("com.rim.bb.app.adobeReader.viewer");
+            break;
+        case FileType::Image:
+            request.setTarget("sys.pictures.card.previewer");
+            break;
+        case FileType::Doc:
+            request.setTarget("sys.wordtogo.previewer");
+            break;
+        case FileType::SpreadSheet:
+            request.setTarget("sys.sheettogo.previewer");
+            break;
+        case FileType::Presentation:
+            request.setTarget("sys.slideshowtogo.previewer");
+            break;
+        case FileType::Audio:
+        case FileType::Video:
+            request.setTarget("sys.mediaplayer.previewer");
+            break;
+        default:
+            break;
     }
 
     invokeCore(request);
@@ -228,11 +271,6 @@ void FileUtil::onCoreInvoked() {
 
     qDebug() << m_invokeReply->error() << endl;
 
-    if (m_pTempLink != 0) {
-        delete m_pTempLink;
-        m_pTempLink = 0;
-    }
-
     delete m_invokeReply;
     m_invokeReply = 0;
 }
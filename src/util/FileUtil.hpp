@@ -16,7 +16,12 @@
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QNetworkRequest>
+#include <QFile>
+#include <QHash>
 #include <qdropbox/QDropboxTempLink.hpp>
+#include "BlobCache.hpp"
+#include "FsWorker.hpp"
+#include "../Logger.hpp"
 
 using namespace bb::system;
 
@@ -35,27 +40,30 @@ public:
     Q_INVOKABLE bool isPdf(const QString& ext);
     Q_INVOKABLE QString filename(const QString& filepath);
     Q_INVOKABLE bool removeDir(const QString& dirName);
+    Q_INVOKABLE void removeDirAsync(const QString& dirName);
     Q_INVOKABLE QString extension(const QString& nameOrPath);
 
     Q_INVOKABLE void open(const QVariantMap& linkMap);
 
+    Q_SIGNALS:
+        void dirRemoved(const QString& path, bool ok);
+
 private slots:
+    void onTreeRemoved(int id, const QString& path, bool ok);
     void onCoreInvoked();
     void onTempLinkLoaded();
+    void onTempLinkReadyRead();
 
 private:
-    QStringList m_imagesList;
-    QStringList m_videoList;
-    QStringList m_audioList;
-    QStringList m_docList;
-    QStringList m_xlsList;
-    QStringList m_pptList;
+    static Logger logger;
 
     QNetworkAccessManager m_network;
     InvokeManager m_invokeManager;
     InvokeTargetReply* m_invokeReply;
+    FsWorker* m_pFs;
 
-    QDropboxTempLink* m_pTempLink;
+    QHash<QNetworkReply*, QFile*> m_downloads;
+    BlobCache m_blobCache;
 
     void invokeCore(InvokeRequest& request);
     void openLocalFile(const QString& path, const QString& ext);
@@ -0,0 +1,176 @@
+/*
+ * FsWorker.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#include "FsWorker.hpp"
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QVariantMap>
+#include <QMetaType>
+
+Logger FsWorker::logger = Logger::getLogger("FsWorker");
+
+FsWorker::FsWorker(QObject* parent) : QObject(parent), m_pTask(new FsTask()), m_nextId(0), m_pending(0),
+        m_completed(0), m_totalQueueLatency(0), m_maxQueueLatency(0), m_totalRunTime(0) {
+    qRegisterMetaType<qint64>("qint64");
+
+    m_pTask->moveToThread(&m_thread);
+
+    bool res = QObject::connect(m_pTask, SIGNAL(scanned(int, const QString&, const QStringList&, qint64, qint64)), this, SLOT(onScanned(int, const QString&, const QStringList&, qint64, qint64)));
+    Q_ASSERT(res);
+    res = QObject::connect(m_pTask, SIGNAL(treeRemoved(int, const QString&, bool, qint64, qint64)), this, SLOT(onTreeRemoved(int, const QString&, bool, qint64, qint64)));
+    Q_ASSERT(res);
+    res = QObject::connect(m_pTask, SIGNAL(statted(int, const QVariantList&, qint64, qint64)), this, SLOT(onStatted(int, const QVariantList&, qint64, qint64)));
+    Q_ASSERT(res);
+    res = QObject::connect(&m_thread, SIGNAL(finished()), m_pTask, SLOT(deleteLater()));
+    Q_ASSERT(res);
+    Q_UNUSED(res);
+
+    m_thread.start(QThread::LowPriority);
+}
+
+FsWorker::~FsWorker() {
+    m_thread.quit();
+    m_thread.wait();
+}
+
+int FsWorker::scan(const QString& path) {
+    int id = ++m_nextId;
+    m_pending++;
+    QMetaObject::invokeMethod(m_pTask, "scan", Qt::QueuedConnection, Q_ARG(int, id), Q_ARG(QString, path), Q_ARG(qint64, QDateTime::currentMSecsSinceEpoch()));
+    return id;
+}
+
+int FsWorker::removeTree(const QString& path) {
+    int id = ++m_nextId;
+    m_pending++;
+    QMetaObject::invokeMethod(m_pTask, "removeTree", Qt::QueuedConnection, Q_ARG(int, id), Q_ARG(QString, path), Q_ARG(qint64, QDateTime::currentMSecsSinceEpoch()));
+    return id;
+}
+
+int FsWorker::stat(const QStringList& paths) {
+    int id = ++m_nextId;
+    m_pending++;
+    QMetaObject::invokeMethod(m_pTask, "stat", Qt::QueuedConnection, Q_ARG(int, id), Q_ARG(QStringList, paths), Q_ARG(qint64, QDateTime::currentMSecsSinceEpoch()));
+    return id;
+}
+
+void FsWorker::onScanned(int id, const QString& path, const QStringList& files, qint64 waited, qint64 took) {
+    record("scan " + path + " (" + QString::number(files.size()) + " files)", waited, took);
+    emit scanned(id, path, files);
+}
+
+void FsWorker::onTreeRemoved(int id, const QString& path, bool ok, qint64 waited, qint64 took) {
+    record("remove " + path, waited, took);
+    emit treeRemoved(id, path, ok);
+}
+
+void FsWorker::onStatted(int id, const QVariantList& stats, qint64 waited, qint64 took) {
+    record("stat " + QString::number(stats.size()) + " paths", waited, took);
+    emit statted(id, stats);
+}
+
+void FsWorker::record(const QString& op, const qint64& waited, const qint64& took) {
+    m_pending--;
+    m_completed++;
+    m_totalQueueLatency += waited;
+    m_maxQueueLatency = qMax(m_maxQueueLatency, waited);
+    m_totalRunTime += took;
+
+    LOG_DEBUG(logger, op + ": waited " + QString::number(waited) + " ms, took " + QString::number(took) + " ms, pending: " + QString::number(m_pending));
+}
+
+int FsWorker::pending() const {
+    return m_pending;
+}
+
+int FsWorker::getCompleted() const {
+    return m_completed;
+}
+
+qint64 FsWorker::getAverageQueueLatency() const {
+    return m_completed ? m_totalQueueLatency / m_completed : 0;
+}
+
+qint64 FsWorker::getMaxQueueLatency() const {
+    return m_maxQueueLatency;
+}
+
+qint64 FsWorker::getAverageRunTime() const {
+    return m_completed ? m_totalRunTime / m_completed : 0;
+}
+
+QStringList FsWorker::scanTree(const QString& path) {
+    QStringList files;
+    QDirIterator it(path, QDir::NoDotAndDotDot | QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        files.append(it.next());
+    }
+    return files;
+}
+
+bool FsWorker::removeRecursively(const QString& path) {
+    QFileInfo info(path);
+    if (!info.exists()) {
+        return true;
+    }
+    if (!info.isDir() || info.isSymLink()) {
+        return QFile::remove(path);
+    }
+
+    bool result = true;
+    QDir dir(path);
+    QFileInfoList list = dir.entryInfoList(QDir::NoDotAndDotDot | QDir::System | QDir::Hidden | QDir::AllDirs | QDir::Files, QDir::DirsFirst);
+    foreach(QFileInfo entry, list) {
+        result = removeRecursively(entry.absoluteFilePath());
+        if (!result) {
+            return result;
+        }
+    }
+    return dir.rmdir(path);
+}
+
+QVariantList FsWorker::statAll(const QStringList& paths) {
+    QVariantList stats;
+    foreach(QString path, paths) {
+        QFileInfo info(path);
+        QVariantMap stat;
+        stat["path"] = path;
+        stat["exists"] = info.exists();
+        if (info.exists()) {
+            stat["size"] = info.size();
+            stat["mtime"] = info.lastModified().toTime_t();
+            stat["dir"] = info.isDir();
+        }
+        stats.append(stat);
+    }
+    return stats;
+}
+
+FsTask::FsTask(QObject* parent) : QObject(parent) {}
+
+FsTask::~FsTask() {}
+
+void FsTask::scan(int id, const QString& path, qint64 enqueuedAt) {
+    qint64 started = QDateTime::currentMSecsSinceEpoch();
+    QStringList files = FsWorker::scanTree(path);
+    emit scanned(id, path, files, started - enqueuedAt, QDateTime::currentMSecsSinceEpoch() - started);
+}
+
+void FsTask::removeTree(int id, const QString& path, qint64 enqueuedAt) {
+    qint64 started = QDateTime::currentMSecsSinceEpoch();
+    bool ok = FsWorker::removeRecursively(path);
+    emit treeRemoved(id, path, ok, started - enqueuedAt, QDateTime::currentMSecsSinceEpoch() - started);
+}
+
+void FsTask::stat(int id, const QStringList& paths, qint64 enqueuedAt) {
+    qint64 started = QDateTime::currentMSecsSinceEpoch();
+    QVariantList stats = FsWorker::statAll(paths);
+    emit statted(id, stats, started - enqueuedAt, QDateTime::currentMSecsSinceEpoch() - started);
+}
@@ -0,0 +1,91 @@
+/*
+ * FsWorker.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#ifndef FSWORKER_HPP_
+#define FSWORKER_HPP_
+
+#include <QObject>
+#include <QThread>
+#include <QStringList>
+#include <QVariantList>
+#include "../Logger.hpp"
+
+class FsTask;
+
+/**
+ * Runs recursive filesystem work on a dedicated thread so it never blocks the event loop.
+ * Every call returns a request id right away. The result comes back later through the
+ * matching signal, and requests run one at a time in the order they were made.
+ */
+class FsWorker: public QObject {
+    Q_OBJECT
+public:
+    FsWorker(QObject* parent = 0);
+    virtual ~FsWorker();
+
+    int scan(const QString& path);
+    int removeTree(const QString& path);
+    int stat(const QStringList& paths);
+
+    int pending() const;
+    int getCompleted() const;
+    qint64 getAverageQueueLatency() const;
+    qint64 getMaxQueueLatency() const;
+    qint64 getAverageRunTime() const;
+
+    static QStringList scanTree(const QString& path);
+    static bool removeRecursively(const QString& path);
+    static QVariantList statAll(const QStringList& paths);
+
+    Q_SIGNALS:
+        void scanned(int id, const QString& path, const QStringList& files);
+        void treeRemoved(int id, const QString& path, bool ok);
+        void statted(int id, const QVariantList& stats);
+
+private slots:
+    void onScanned(int id, const QString& path, const QStringList& files, qint64 waited, qint64 took);
+    void onTreeRemoved(int id, const QString& path, bool ok, qint64 waited, qint64 took);
+    void onStatted(int id, const QVariantList& stats, qint64 waited, qint64 took);
+
+private:
+    static Logger logger;
+
+    QThread m_thread;
+    FsTask* m_pTask;
+    int m_nextId;
+    int m_pending;
+
+    int m_completed;
+    qint64 m_totalQueueLatency;
+    qint64 m_maxQueueLatency;
+    qint64 m_totalRunTime;
+
+    void record(const QString& op, const qint64& waited, const qint64& took);
+};
+
+/**
+ * Lives on the FsWorker thread. Each slot gets the time it was enqueued at so the
+ * time spent waiting in the queue can be reported next to the time spent running.
+ */
+class FsTask: public QObject {
+    Q_OBJECT
+public:
+    FsTask(QObject* parent = 0);
+    virtual ~FsTask();
+
+    Q_SIGNALS:
+        void scanned(int id, const QString& path, const QStringList& files, qint64 waited, qint64 took);
+        void treeRemoved(int id, const QString& path, bool ok, qint64 waited, qint64 took);
+        void statted(int id, const QVariantList& stats, qint64 waited, qint64 took);
+
+public slots:
+    void scan(int id, const QString& path, qint64 enqueuedAt);
+    void removeTree(int id, const QString& path, qint64 enqueuedAt);
+    void stat(int id, const QStringList& paths, qint64 enqueuedAt);
+};
+
+#endif /* FSWORKER_HPP_ */
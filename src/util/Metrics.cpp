@@ -0,0 +1,175 @@
+/*
+ * Metrics.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#include "Metrics.hpp"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <stdio.h>
+#include "../qjson/serializer.h"
+
+#define SUB_BUCKET_BITS 3 // log2(HISTOGRAM_SUB_BUCKETS)
+
+QMutex Metrics::s_mutex;
+QMap<QString, Counter*> Metrics::s_counters;
+QMap<QString, Gauge*> Metrics::s_gauges;
+QMap<QString, Histogram*> Metrics::s_histograms;
+
+Histogram::Histogram() : m_count(0), m_max(0) {
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        m_buckets[i] = 0;
+    }
+}
+
+void Histogram::record(const int& value) {
+    int v = qMax(value, 0);
+    m_buckets[bucketOf(v)].fetchAndAddRelaxed(1);
+    m_count.fetchAndAddRelaxed(1);
+
+    int max = m_max;
+    while (v > max && !m_max.testAndSetRelaxed(max, v)) {
+        max = m_max;
+    }
+}
+
+int Histogram::count() const {
+    return m_count;
+}
+
+qint64 Histogram::sum() const {
+    // estimated from bucket midpoints, exact below HISTOGRAM_SUB_BUCKETS
+    qint64 total = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        int n = m_buckets[i];
+        if (n) {
+            qint64 low = lowerBoundOf(i);
+            qint64 high = i + 1 < HISTOGRAM_BUCKETS ? lowerBoundOf(i + 1) - 1 : low;
+            total += n * ((low + high) / 2);
+        }
+    }
+    return total;
+}
+
+int Histogram::max() const {
+    return m_max;
+}
+
+int Histogram::percentile(const double& p) const {
+    int total = m_count;
+    if (total == 0) {
+        return 0;
+    }
+
+    qint64 target = (qint64) (total * p + 0.5);
+    qint64 seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += (int) m_buckets[i];
+        if (seen >= target && seen > 0) {
+            return qMin(i + 1 < HISTOGRAM_BUCKETS ? lowerBoundOf(i + 1) - 1 : (int) m_max, (int) m_max);
+        }
+    }
+    return m_max;
+}
+
+QVariantMap Histogram::snapshot() const {
+    QVariantMap map;
+    int n = count();
+    map["count"] = n;
+    map["mean"] = n ? sum() / n : 0;
+    map["p50"] = percentile(0.5);
+    map["p90"] = percentile(0.9);
+    map["p99"] = percentile(0.99);
+    map["max"] = max();
+    return map;
+}
+
+int Histogram::bucketOf(const int& value) {
+    if (value < HISTOGRAM_SUB_BUCKETS) {
+        return value;
+    }
+
+    int msb = 31 - __builtin_clz((unsigned int) value);
+    int shift = msb - SUB_BUCKET_BITS;
+    int bucket = (shift + 1) * HISTOGRAM_SUB_BUCKETS + ((value >> shift) & (HISTOGRAM_SUB_BUCKETS - 1));
+    return qMin(bucket, HISTOGRAM_BUCKETS - 1);
+}
+
+int Histogram::lowerBoundOf(const int& bucket) {
+    if (bucket < HISTOGRAM_SUB_BUCKETS) {
+        return bucket;
+    }
+
+    int shift = bucket / HISTOGRAM_SUB_BUCKETS - 1;
+    int sub = bucket % HISTOGRAM_SUB_BUCKETS;
+    return (HISTOGRAM_SUB_BUCKETS + sub) << shift;
+}
+
+Counter* Metrics::counter(const QString& name) {
+    QMutexLocker locker(&s_mutex);
+    if (!s_counters.contains(name)) {
+        s_counters[name] = new Counter();
+    }
+    return s_counters.value(name);
+}
+
+Gauge* Metrics::gauge(const QString& name) {
+    QMutexLocker locker(&s_mutex);
+    if (!s_gauges.contains(name)) {
+        s_gauges[name] = new Gauge();
+    }
+    return s_gauges.value(name);
+}
+
+Histogram* Metrics::histogram(const QString& name) {
+    QMutexLocker locker(&s_mutex);
+    if (!s_histograms.contains(name)) {
+        s_histograms[name] = new Histogram();
+    }
+    return s_histograms.value(name);
+}
+
+QVariantMap Metrics::snapshot() {
+    QMutexLocker locker(&s_mutex);
+    QVariantMap counters;
+    foreach(QString name, s_counters.keys()) {
+        counters[name] = s_counters.value(name)->value();
+    }
+
+    QVariantMap gauges;
+    foreach(QString name, s_gauges.keys()) {
+        gauges[name] = s_gauges.value(name)->value();
+    }
+
+    QVariantMap histograms;
+    foreach(QString name, s_histograms.keys()) {
+        histograms[name] = s_histograms.value(name)->snapshot();
+    }
+
+    QVariantMap map;
+    map["time"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    map["counters"] = counters;
+    map["gauges"] = gauges;
+    map["histograms"] = histograms;
+    return map;
+}
+
+bool Metrics::dump(const QString& filePath, const QVariantMap& data) {
+    QDir dir(QFileInfo(filePath).absolutePath());
+    if (!dir.exists()) {
+        dir.mkpath(dir.absolutePath());
+    }
+
+    QFile file(filePath + ".tmp");
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    file.write(QJson::Serializer().serialize(data));
+    file.close();
+    return ::rename(QFile::encodeName(file.fileName()).constData(), QFile::encodeName(filePath).constData()) == 0;
+}
@@ -0,0 +1,97 @@
+/*
+ * Metrics.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#ifndef METRICS_HPP_
+#define METRICS_HPP_
+
+#include <QAtomicInt>
+#include <QString>
+#include <QVariantMap>
+#include <QMap>
+#include <QMutex>
+
+#define HISTOGRAM_SUB_BUCKETS 8 // per power of two, about 12% relative error
+#define HISTOGRAM_BUCKETS (HISTOGRAM_SUB_BUCKETS * 29)
+
+class Counter {
+public:
+    Counter() : m_value(0) {}
+
+    void add(const int& n = 1) {
+        m_value.fetchAndAddRelaxed(n);
+    }
+
+    int value() const {
+        return m_value;
+    }
+
+private:
+    QAtomicInt m_value;
+};
+
+class Gauge {
+public:
+    Gauge() : m_value(0) {}
+
+    void set(const int& value) {
+        m_value.fetchAndStoreRelaxed(value);
+    }
+
+    int value() const {
+        return m_value;
+    }
+
+private:
+    QAtomicInt m_value;
+};
+
+/**
+ * Log-linear histogram in the spirit of HdrHistogram: every power of two is split into
+ * HISTOGRAM_SUB_BUCKETS linear buckets, so recording is a couple of shifts and a few atomic adds.
+ * Sum and percentiles are estimated from the buckets.
+ */
+class Histogram {
+public:
+    Histogram();
+
+    void record(const int& value);
+    int count() const;
+    qint64 sum() const;
+    int max() const;
+    int percentile(const double& p) const;
+    QVariantMap snapshot() const;
+
+private:
+    QAtomicInt m_buckets[HISTOGRAM_BUCKETS];
+    QAtomicInt m_count;
+    QAtomicInt m_max;
+
+    static int bucketOf(const int& value);
+    static int lowerBoundOf(const int& bucket);
+};
+
+/**
+ * Named counters, gauges and histograms. Lookups take a lock, so callers keep the
+ * returned pointer; updates through it are lock-free and safe from any thread.
+ */
+class Metrics {
+public:
+    static Counter* counter(const QString& name);
+    static Gauge* gauge(const QString& name);
+    static Histogram* histogram(const QString& name);
+
+    static QVariantMap snapshot();
+    static bool dump(const QString& filePath, const QVariantMap& data);
+
+private:
+    static QMutex s_mutex;
+    static QMap<QString, Counter*> s_counters;
+    static QMap<QString, Gauge*> s_gauges;
+    static QMap<QString, Histogram*> s_histograms;
+};
+
+#endif /* METRICS_HPP_ */
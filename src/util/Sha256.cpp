@@ -0,0 +1,145 @@
+/*
+ * Sha256.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#include "Sha256.hpp"
+#include <string.h>
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static const quint32 K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+Sha256::Sha256() : m_length(0), m_buffered(0), m_finished(false) {
+    m_state[0] = 0x6a09e667;
+    m_state[1] = 0xbb67ae85;
+    m_state[2] = 0x3c6ef372;
+    m_state[3] = 0xa54ff53a;
+    m_state[4] = 0x510e527f;
+    m_state[5] = 0x9b05688c;
+    m_state[6] = 0x1f83d9ab;
+    m_state[7] = 0x5be0cd19;
+}
+
+void Sha256::addData(const char* data, qint64 length) {
+    Q_ASSERT(!m_finished);
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    m_length += length;
+
+    if (m_buffered) {
+        int n = (int) qMin((qint64) (64 - m_buffered), length);
+        memcpy(m_buffer + m_buffered, p, n);
+        m_buffered += n;
+        p += n;
+        length -= n;
+        if (m_buffered < 64) {
+            return;
+        }
+        transform(m_buffer);
+        m_buffered = 0;
+    }
+
+    while (length >= 64) {
+        transform(p);
+        p += 64;
+        length -= 64;
+    }
+
+    if (length > 0) {
+        memcpy(m_buffer, p, (size_t) length);
+        m_buffered = (int) length;
+    }
+}
+
+void Sha256::addData(const QByteArray& data) {
+    addData(data.constData(), data.size());
+}
+
+QByteArray Sha256::result() {
+    if (m_finished) {
+        return m_result;
+    }
+
+    quint64 bits = m_length * 8;
+    unsigned char pad[72];
+    int padLength = (m_buffered < 56) ? 56 - m_buffered : 120 - m_buffered;
+    memset(pad, 0, sizeof(pad));
+    pad[0] = 0x80;
+    for (int i = 0; i < 8; i++) {
+        pad[padLength + i] = (unsigned char) (bits >> (56 - i * 8));
+    }
+    addData(reinterpret_cast<const char*>(pad), padLength + 8);
+    m_finished = true;
+
+    m_result.resize(32);
+    for (int i = 0; i < 8; i++) {
+        m_result[i * 4] = (char) (m_state[i] >> 24);
+        m_result[i * 4 + 1] = (char) (m_state[i] >> 16);
+        m_result[i * 4 + 2] = (char) (m_state[i] >> 8);
+        m_result[i * 4 + 3] = (char) m_state[i];
+    }
+    return m_result;
+}
+
+QByteArray Sha256::hash(const char* data, qint64 length) {
+    Sha256 sha;
+    sha.addData(data, length);
+    return sha.result();
+}
+
+QByteArray Sha256::hash(const QByteArray& data) {
+    return hash(data.constData(), data.size());
+}
+
+void Sha256::transform(const unsigned char* block) {
+    quint32 w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((quint32) block[i * 4] << 24) | ((quint32) block[i * 4 + 1] << 16) | ((quint32) block[i * 4 + 2] << 8) | (quint32) block[i * 4 + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        quint32 s0 = ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        quint32 s1 = ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    quint32 a = m_state[0], b = m_state[1], c = m_state[2], d = m_state[3];
+    quint32 e = m_state[4], f = m_state[5], g = m_state[6], h = m_state[7];
+
+    for (int i = 0; i < 64; i++) {
+        quint32 S1 = ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25);
+        quint32 ch = (e & f) ^ (~e & g);
+        quint32 t1 = h + S1 + ch + K[i] + w[i];
+        quint32 S0 = ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22);
+        quint32 maj = (a & b) ^ (a & c) ^ (b & c);
+        quint32 t2 = S0 + maj;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    m_state[0] += a;
+    m_state[1] += b;
+    m_state[2] += c;
+    m_state[3] += d;
+    m_state[4] += e;
+    m_state[5] += f;
+    m_state[6] += g;
+    m_state[7] += h;
+}
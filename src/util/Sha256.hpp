@@ -0,0 +1,38 @@
+/*
+ * Sha256.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#ifndef SHA256_HPP_
+#define SHA256_HPP_
+
+#include <QByteArray>
+
+/**
+ * Plain SHA-256, QCryptographicHash in Qt 4 has no SHA-2.
+ */
+class Sha256 {
+public:
+    Sha256();
+
+    void addData(const char* data, qint64 length);
+    void addData(const QByteArray& data);
+    QByteArray result();
+
+    static QByteArray hash(const char* data, qint64 length);
+    static QByteArray hash(const QByteArray& data);
+
+private:
+    quint32 m_state[8];
+    unsigned char m_buffer[64];
+    quint64 m_length;
+    int m_buffered;
+    bool m_finished;
+    QByteArray m_result;
+
+    void transform(const unsigned char* block);
+};
+
+#endif /* SHA256_HPP_ */
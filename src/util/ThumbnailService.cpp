@@ -0,0 +1,235 @@
+/*
+ * ThumbnailService.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#include "ThumbnailService.hpp"
+#include "DownloadManager.hpp"
+#include "FileType.hpp"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDataStream>
+#include <QNetworkRequest>
+#include <QUrl>
+#include <QStringList>
+#include <utime.h>
+#include <stdio.h>
+#include <qdropbox/QDropboxFile.hpp>
+#include "Metrics.hpp"
+#include "../Common.hpp"
+
+#define THUMBNAIL_URL "https://content.dropboxapi.com/2/files/get_thumbnail"
+#define CONTENT_TYPE "text/plain; charset=dropbox-cors-hack"
+#define THUMBNAIL_SIZE "w256h256"
+#define THUMBNAIL_EXT ".jpg"
+#define PART_SUFFIX ".part"
+#define INDEX_FILE "index"
+
+Logger ThumbnailService::logger = Logger::getLogger("ThumbnailService");
+
+ThumbnailService::ThumbnailService(QObject* parent) : QObject(parent), m_root(QDir::currentPath() + THUMBNAILS_DIR), m_count(0),
+        m_hits(0), m_misses(0), m_evictions(0) {
+    QDir dir(m_root);
+    if (!dir.exists()) {
+        dir.mkpath(m_root);
+    }
+    m_count = dir.entryList(QStringList() << "*" THUMBNAIL_EXT, QDir::Files).size();
+    loadIndex();
+}
+
+ThumbnailService::~ThumbnailService() {
+    foreach(QNetworkReply* reply, m_active.keys()) {
+        reply->abort();
+        reply->deleteLater();
+    }
+    m_active.clear();
+    saveIndex();
+}
+
+void ThumbnailService::setAccessToken(const QString& accessToken) {
+    m_accessToken = accessToken;
+}
+
+void ThumbnailService::prefetch(const QVariantList& files) {
+    bool changed = false;
+    foreach(QVariant v, files) {
+        QDropboxFile file;
+        file.fromMap(v.toMap());
+        QString hash = file.getContentHash();
+        if (file.getTag().compare("file") != 0 || hash.isEmpty() || !isImage(file.getName())) {
+            continue;
+        }
+
+        QString remotePath = file.getPathDisplay();
+        if (m_hashes.value(remotePath.toLower()).compare(hash) != 0) {
+            invalidate(remotePath, hash);
+            changed = true;
+        }
+
+        QString localPath = pathFor(hash);
+        if (QFile::exists(localPath)) {
+            m_hits++;
+            Metrics::counter("thumbnails.hits")->add();
+            utime(QFile::encodeName(localPath).constData(), 0);
+            continue;
+        }
+
+        if (m_requested.contains(hash)) {
+            continue;
+        }
+        m_misses++;
+        Metrics::counter("thumbnails.misses")->add();
+        m_requested.insert(hash);
+
+        Request r;
+        r.remotePath = remotePath;
+        r.contentHash = hash;
+        m_queue.enqueue(r);
+    }
+
+    if (changed) {
+        saveIndex();
+    }
+    processQueue();
+}
+
+QString ThumbnailService::pathFor(const QString& contentHash) const {
+    return m_root + "/" + contentHash + THUMBNAIL_EXT;
+}
+
+void ThumbnailService::clear() {
+    m_queue.clear();
+    m_requested.clear();
+    m_hashes.clear();
+    m_refs.clear();
+    foreach(QString name, QDir(m_root).entryList(QDir::Files)) {
+        QFile::remove(m_root + "/" + name);
+    }
+    m_count = 0;
+}
+
+bool ThumbnailService::isImage(const QString& name) {
+    return FileType::fromExtension(FileType::extension(name)) == FileType::Image;
+}
+
+void ThumbnailService::processQueue() {
+    while (m_active.size() < THUMBNAILS_QUEUE_SIZE && !m_queue.isEmpty()) {
+        Request r = m_queue.dequeue();
+
+        QNetworkRequest req;
+        req.setUrl(QUrl(THUMBNAIL_URL));
+        req.setRawHeader("Authorization", "Bearer " + m_accessToken.toUtf8());
+        req.setRawHeader("Dropbox-API-Arg", "{\"path\": " + DownloadManager::jsonString(r.remotePath) + ", \"format\": \"jpeg\", \"size\": \"" THUMBNAIL_SIZE "\"}");
+        req.setHeader(QNetworkRequest::ContentTypeHeader, CONTENT_TYPE);
+
+        QNetworkReply* reply = m_network.post(req, QByteArray());
+        m_active[reply] = r;
+
+        bool res = QObject::connect(reply, SIGNAL(finished()), this, SLOT(onFinished()));
+        Q_ASSERT(res);
+        Q_UNUSED(res);
+    }
+}
+
+void ThumbnailService::onFinished() {
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(QObject::sender());
+    Request r = m_active.take(reply);
+    reply->deleteLater();
+    m_requested.remove(r.contentHash);
+
+    if (reply->error() == QNetworkReply::NoError) {
+        // written aside and renamed, a killed process must not leave a truncated jpeg that counts as a hit
+        QString localPath = pathFor(r.contentHash);
+        QFile file(localPath + PART_SUFFIX);
+        if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            bool written = file.write(reply->readAll()) != -1 && file.flush();
+            file.close();
+            if (written && ::rename(QFile::encodeName(file.fileName()).constData(), QFile::encodeName(localPath).constData()) == 0) {
+                m_count++;
+                emit thumbnailReady(r.remotePath, localPath);
+            } else {
+                file.remove();
+            }
+        }
+    } else {
+        logger.error("Thumbnail failed: " + r.remotePath + ", " + reply->errorString());
+    }
+
+    if (m_count > THUMBNAILS_THRESHOLD) {
+        evict();
+    }
+
+    if (m_active.isEmpty() && m_queue.isEmpty()) {
+        logger.info("Thumbnails: " + QString::number(m_count) + ", hits: " + QString::number(m_hits) +
+                ", misses: " + QString::number(m_misses) + ", evictions: " + QString::number(m_evictions));
+    }
+    processQueue();
+}
+
+void ThumbnailService::invalidate(const QString& remotePath, const QString& contentHash) {
+    QString key = remotePath.toLower();
+    QString prevHash = m_hashes.value(key);
+    m_hashes[key] = contentHash;
+    m_refs[contentHash]++;
+
+    // m_refs counts the paths per hash, equal files share one thumbnail until the last of them changes
+    if (prevHash.isEmpty()) {
+        return;
+    }
+    if (--m_refs[prevHash] <= 0) {
+        m_refs.remove(prevHash);
+        if (QFile::remove(pathFor(prevHash))) {
+            m_count--;
+            logger.debug("Thumbnail invalidated: " + remotePath);
+        }
+    }
+}
+
+void ThumbnailService::evict() {
+    QFileInfoList thumbnails = QDir(m_root).entryInfoList(QStringList() << "*" THUMBNAIL_EXT, QDir::Files, QDir::Time | QDir::Reversed);
+    m_count = thumbnails.size();
+
+    QSet<QString> evicted;
+    for (int i = 0; i < thumbnails.size() && m_count > THUMBNAILS_THRESHOLD; i++) {
+        if (QFile::remove(thumbnails.at(i).absoluteFilePath())) {
+            evicted.insert(thumbnails.at(i).completeBaseName());
+            m_count--;
+            m_evictions++;
+        }
+    }
+
+    QMutableMapIterator<QString, QString> it(m_hashes);
+    while (it.hasNext()) {
+        it.next();
+        if (evicted.contains(it.value())) {
+            m_refs.remove(it.value());
+            it.remove();
+        }
+    }
+    saveIndex();
+}
+
+void ThumbnailService::loadIndex() {
+    QFile file(m_root + "/" + INDEX_FILE);
+    if (file.open(QIODevice::ReadOnly)) {
+        QDataStream in(&file);
+        in >> m_hashes;
+        file.close();
+    }
+
+    foreach(QString hash, m_hashes) {
+        m_refs[hash]++;
+    }
+}
+
+void ThumbnailService::saveIndex() {
+    QFile file(m_root + "/" + INDEX_FILE);
+    if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        QDataStream out(&file);
+        out << m_hashes;
+        file.close();
+    }
+}
@@ -0,0 +1,74 @@
+/*
+ * ThumbnailService.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: doctorrokter
+ */
+
+#ifndef THUMBNAILSERVICE_HPP_
+#define THUMBNAILSERVICE_HPP_
+
+#include <QObject>
+#include <QQueue>
+#include <QMap>
+#include <QSet>
+#include <QVariantList>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include "../Logger.hpp"
+
+/**
+ * Fetches thumbnails for image entries in the background, at most THUMBNAILS_QUEUE_SIZE at a time.
+ * Thumbnails live in THUMBNAILS_DIR as <content_hash>.jpg, so a changed file never hits a stale one.
+ * The previous thumbnail of a changed path is dropped, and the least recently used
+ * ones are evicted once there are more than THUMBNAILS_THRESHOLD.
+ */
+class ThumbnailService: public QObject {
+    Q_OBJECT
+public:
+    ThumbnailService(QObject* parent = 0);
+    virtual ~ThumbnailService();
+
+    void setAccessToken(const QString& accessToken);
+    void prefetch(const QVariantList& files);
+    QString pathFor(const QString& contentHash) const;
+    void clear();
+
+    static bool isImage(const QString& name);
+
+    Q_SIGNALS:
+        void thumbnailReady(const QString& remotePath, const QString& localPath);
+
+private slots:
+    void onFinished();
+
+private:
+    struct Request {
+        QString remotePath;
+        QString contentHash;
+    };
+
+    static Logger logger;
+
+    QNetworkAccessManager m_network;
+    QString m_accessToken;
+    QString m_root;
+    QQueue<Request> m_queue;
+    QMap<QNetworkReply*, Request> m_active;
+    QSet<QString> m_requested;
+    QMap<QString, QString> m_hashes;
+    QMap<QString, int> m_refs;
+    int m_count;
+
+    int m_hits;
+    int m_misses;
+    int m_evictions;
+
+    void processQueue();
+    void invalidate(const QString& remotePath, const QString& contentHash);
+    void evict();
+    void loadIndex();
+    void saveIndex();
+};
+
+#endif /* THUMBNAILSERVICE_HPP_ */